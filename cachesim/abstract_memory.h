@@ -10,6 +10,7 @@
 
 #include "common.h"
 #include "statistics.h"
+#include "trace.h"
 
 struct AbstractMemory;
 typedef struct AbstractMemory AbstractMemory;
@@ -30,17 +31,17 @@ typedef struct AbstractMemoryOps
   \param m Указатель на структуру описания модели памяти
   \param addr Адрес в памяти
   \param size Количество считываемых ячеек
-  \param dst Указатель, куда копировать ячейки из памяти
+  \param dst Ячейки, куда копировать содержимое памяти (dst.value == NULL - не копировать)
  */
-    void (*read)(AbstractMemory *m, memaddr_t addr, int size, MemoryCell *dst);
+    void (*read)(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst);
 /*!
   Записать ячейки в память
   \param m Указатель на структуру описания модели памяти
   \param addr Адрес в памяти
   \param size Количество записываемых ячеек
-  \param src Указатель, откуда копировать ячейки в память
+  \param src Ячейки, откуда копировать содержимое в память (src.value == NULL - содержимое не передается)
  */
-    void (*write)(AbstractMemory *m, memaddr_t addr, int size, const MemoryCell *src);
+    void (*write)(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src);
 /*!
   "Раскрыть" содержимое указанных ячеек памяти. Эта функция необходима, так как начальное состояние
   памяти неизвестно, и значения ячеек памяти могут определяться как при записи, так и при чтении,
@@ -49,9 +50,33 @@ typedef struct AbstractMemoryOps
   \param a Указатель на структуру описания модели памяти
   \param addr Адрес в памяти
   \param size Количество считываемых ячеек
-  \param src Указатель, откуда копировать ячейки в память
+  \param src Ячейки, откуда копировать содержимое в память (src.value == NULL - содержимое не передается)
  */
-    void (*reveal)(AbstractMemory *m, memaddr_t addr, int size, const MemoryCell *src);
+    void (*reveal)(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src);
+/*!
+  Прочитать ячейки из памяти и "раскрыть" их содержимое. Результат тот же, что у вызова read
+  (без копирования) и затем reveal, но модель кеша ищет блок только один раз.
+  \param m Указатель на структуру описания модели памяти
+  \param addr Адрес в памяти
+  \param size Количество считываемых ячеек
+  \param src Прочитанное содержимое ячеек (src.value == NULL - содержимое не передается)
+ */
+    void (*read_reveal)(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src);
+/*!
+  Выполнить пачку шагов чтения: для каждого шага по порядку то же, что read_reveal с данными шага.
+  Модель может накапливать статистику пачки в локальных переменных.
+  \param m Указатель на структуру описания модели памяти
+  \param steps Массив шагов трассы
+  \param count Число шагов
+ */
+    void (*read_batch)(AbstractMemory *m, const TraceStep *steps, int count);
+/*!
+  Выполнить пачку шагов записи: для каждого шага по порядку то же, что write с данными шага.
+  \param m Указатель на структуру описания модели памяти
+  \param steps Массив шагов трассы
+  \param count Число шагов
+ */
+    void (*write_batch)(AbstractMemory *m, const TraceStep *steps, int count);
     /*!
       Фиксировать состояние памяти. Например, кеш с отложенной записью
       можно сбросить из кеша все грязные блоки. Для других типов памяти
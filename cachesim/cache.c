@@ -3,26 +3,190 @@
 #include "cache.h"
 #include "direct_cache.h"
 #include "full_cache.h"
+#include "set_cache.h"
+#include "split_cache.h"
 
+#include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 
+enum
+{
+    MAX_LEVELS = 8 //!< Максимальное число уровней иерархии кешей
+};
+
 AbstractMemory *
-cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd)
+cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd, int tag_only)
 {
-    const char *a = config_file_get(cfg, "associativity");
+    char buf[PARAM_BUF_SIZE];
+    const char *a = config_file_get(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "associativity"));
     if (!a) {
-        error_undefined("cache_create", "associativity");
+        error_undefined("cache_create", buf);
     } else if (!strcmp(a, "full")) {
-        return full_cache_create(cfg, var_prefix, info, mem, rnd);
+        return full_cache_create(cfg, var_prefix, info, mem, rnd, tag_only);
     } else if (!strcmp(a, "direct")) {
-        return direct_cache_create(cfg, var_prefix, info, mem, rnd);
+        return direct_cache_create(cfg, var_prefix, info, mem, rnd, tag_only);
+    } else if (isdigit((unsigned char) a[0])) {
+        // число блоков в наборе множественно-ассоциативного кеша
+        return set_cache_create(cfg, var_prefix, info, mem, rnd, tag_only);
     } else {
-        error_invalid("cache_create", "associativity");
+        error_invalid("cache_create", buf);
     }
     mem->ops->free(mem);
     return NULL;
 }
 
+/*!
+  Разобрать список уровней иерархии: имена через запятую, пробелы вокруг имен игнорируются
+  \param levels Значение параметра levels
+  \param names Массив, куда записываются указатели на имена (строки выделяются динамически)
+  \return Число уровней, -1 в случае ошибки
+ */
+static int
+parse_levels(const char *levels, char *names[MAX_LEVELS])
+{
+    int count = 0;
+    const char *p = levels;
+    while (1) {
+        while (isspace((unsigned char) *p)) {
+            p++;
+        }
+        const char *begin = p;
+        while (isalnum((unsigned char) *p) || *p == '_' || *p == '-') {
+            p++;
+        }
+        const char *end = p;
+        while (isspace((unsigned char) *p)) {
+            p++;
+        }
+        if (begin == end || count == MAX_LEVELS || (*p && *p != ',')) {
+            goto parse_levels_failed;
+        }
+        names[count++] = strndup(begin, end - begin);
+        for (int i = 0; i < count - 1; i++) {
+            if (!strcmp(names[i], names[count - 1])) {
+                goto parse_levels_failed;
+            }
+        }
+        if (!*p) {
+            return count;
+        }
+        p++;
+    }
+parse_levels_failed:
+    while (count) {
+        free(names[--count]);
+    }
+    return -1;
+}
+
+/*!
+  Считать размер блока кеша с заданным префиксом
+  \param cfg Указатель на структуру, хранящую конфигурационные параметры
+  \param prefix Префикс имен параметров кеша
+  \param buf Буфер под имя параметра размером PARAM_BUF_SIZE
+  \return Размер блока, 0 - если параметр не задан или некорректен (об этом сообщит функция создания кеша)
+ */
+static int
+read_block_size(const ConfigFile *cfg, const char *prefix, char *buf)
+{
+    int block_size;
+    int r = config_file_get_int(cfg,
+        make_param_name(buf, PARAM_BUF_SIZE, prefix, "block_size"), &block_size);
+    return (r > 0 && block_size > 0) ? block_size : 0;
+}
+
+AbstractMemory *
+cache_hierarchy_create(
+    ConfigFile *cfg,
+    StatisticsInfo *info,
+    AbstractMemory *mem,
+    Random *rnd,
+    int tag_only,
+    AbstractMemory **p_imem)
+{
+    const char fn[] = "cache_hierarchy_create";
+    char *names[MAX_LEVELS];
+    char prefixes[MAX_LEVELS][PARAM_BUF_SIZE];
+    char buf[PARAM_BUF_SIZE];
+    int count = 0, split = 0;
+    *p_imem = NULL;
+
+    const char *value = config_file_get(cfg, "split_l1");
+    if (value && !strcmp(value, "yes")) {
+        split = 1;
+    } else if (value && *value && strcmp(value, "no")) {
+        error_invalid(fn, "split_l1");
+        goto cache_hierarchy_create_failed;
+    }
+    value = config_file_get(cfg, "levels");
+    if (value && *value && (count = parse_levels(value, names)) < 0) {
+        count = 0;
+        error_invalid(fn, "levels");
+        goto cache_hierarchy_create_failed;
+    }
+    if (!split && !count) {
+        StatisticsInfo *cache_info = statistics_create_component(info, "cache");
+        cache_info->hit_counter_needed = 1;
+        mem = cache_create(cfg, NULL, cache_info, mem, rnd, tag_only);
+        *p_imem = mem;
+        return mem;
+    }
+
+    // блок верхнего уровня должен целиком помещаться в блок нижнего:
+    int upper_block_size = 0;
+    if (split) {
+        int icache_block_size = read_block_size(cfg, "icache_", buf);
+        int dcache_block_size = read_block_size(cfg, "dcache_", buf);
+        upper_block_size = (icache_block_size > dcache_block_size) ? icache_block_size : dcache_block_size;
+    }
+    for (int i = 0; i < count; i++) {
+        make_param_name(prefixes[i], sizeof(prefixes[i]), names[i], "_");
+        int block_size = read_block_size(cfg, prefixes[i], buf);
+        if (block_size && block_size < upper_block_size) {
+            error_invalid(fn, buf);
+            goto cache_hierarchy_create_failed;
+        } else if (block_size) {
+            upper_block_size = block_size;
+        }
+    }
+
+    // статистика уровней печатается сверху вниз, а кеши создаются снизу вверх:
+    StatisticsInfo *icache_info = NULL, *dcache_info = NULL;
+    StatisticsInfo *level_info[MAX_LEVELS];
+    if (split) {
+        icache_info = statistics_create_child(info, "icache");
+        dcache_info = statistics_create_child(info, "dcache");
+        icache_info->first_level = dcache_info->first_level = 1;
+    }
+    for (int i = 0; i < count; i++) {
+        level_info[i] = statistics_create_child(info, names[i]);
+    }
+    if (!split) {
+        level_info[0]->first_level = 1;
+    }
+    for (int i = count - 1; i >= 0 && mem; i--) {
+        mem = cache_create(cfg, prefixes[i], level_info[i], mem, rnd, tag_only);
+    }
+    if (mem && split) {
+        mem = split_cache_create(cfg, icache_info, dcache_info, mem, rnd, tag_only);
+        *p_imem = mem ? split_cache_instruction_side(mem) : NULL;
+    } else {
+        *p_imem = mem;
+    }
+    goto cache_hierarchy_create_finally;
+
+cache_hierarchy_create_failed:
+    mem->ops->free(mem);
+    mem = NULL;
+cache_hierarchy_create_finally:
+    for (int i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    return mem;
+}
+
 /*
  * Local variables:
  *  c-basic-offset: 4
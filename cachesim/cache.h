@@ -19,9 +19,37 @@
   \param info Указатель на структуру, хранящую статистику моделирования
   \param mem Указатель на дескриптор нижележащей памяти (в виде указателя на базовую структуру)
   \param rnd Указатель на дескриптор генератора случайных чисел
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно: блоки кеша не хранят данные,
+  моделируются только теги и время доступа
   \return Указатель на структуру описания модели кеша (в виде указателя на базовую структуру)
  */
-AbstractMemory *cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd);
+AbstractMemory *cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd, int tag_only);
+
+/*!
+  Создать иерархию кешей. Если задан параметр levels (список имен уровней через запятую,
+  начиная с ближайшего к процессору), каждый уровень создается функцией cache_create с префиксом
+  "<имя>_" поверх следующего уровня, а нижний - поверх mem. Если параметр split_l1 равен yes,
+  над уровнями levels (или над mem) создаются раздельные кеши команд и данных (см. split_cache_create).
+  Каждый кеш получает свой дочерний дескриптор статистики. Если не задано ни то, ни другое,
+  создается один кеш без префикса, использующий info.
+  \param cfg Указатель на структуру, хранящую конфигурационные параметры
+  \param info Указатель на структуру, хранящую статистику моделирования
+  \param mem Указатель на дескриптор нижележащей памяти (в виде указателя на базовую структуру)
+  \param rnd Указатель на дескриптор генератора случайных чисел
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно: блоки кеша не хранят данные,
+  моделируются только теги и время доступа
+  \param p_imem Указатель, куда записывается модель, через которую выполняются обращения к командам
+  (совпадает с возвращаемой моделью, если кеши команд и данных не разделены)
+  \return Указатель на структуру описания модели верхнего уровня (в виде указателя на базовую структуру),
+  через которую выполняются обращения к данным, NULL в случае ошибки (mem в этом случае освобождается)
+ */
+AbstractMemory *cache_hierarchy_create(
+    ConfigFile *cfg,
+    StatisticsInfo *info,
+    AbstractMemory *mem,
+    Random *rnd,
+    int tag_only,
+    AbstractMemory **p_imem);
 
 #endif
 
@@ -11,15 +11,26 @@
 #include "direct_cache.h"
 #include "full_cache.h"
 #include "memory.h"
+#include "mrc.h"
 #include "parse_config.h"
 #include "random.h"
+#include "simulation.h"
 #include "statistics.h"
+#include "sweep.h"
 #include "trace.h"
+#include "trace_pipeline.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+
+enum
+{
+    MAX_THREADS = 256, //!< Максимальное число рабочих потоков в режиме --sweep
+    RUN_BATCH_SIZE = 1024 //!< Число шагов трассы, передаваемых модели за один раз
+};
 
 /*!
   Выводим сообщения о некорректности аргументов и завершаем выполнение программы с кодом EXIT_FAILURE.
@@ -33,30 +44,78 @@ die_bad_args(void)
 }
 
 /*!
-  Выполняем операцию над памятью, указанную в шаге трассы
-  \param ts Указатель на структуры описанию шага трассы
-  \param m Указатель на структуру описания памяти
-  \param info Указатель на структуру, хранящую статистику моделирования
+  Выполнить все конфигурации за один проход по трассе из stdin и напечатать по строке статистики
+  на каждую конфигурацию
+  \param fnames Пути к конфигурационным файлам
+  \param count Число конфигурационных файлов
+  \param disable_cache Ненулевое значение, если моделируется только ОЗУ без кеша
+  \param threads Число рабочих потоков, 0 - по числу доступных процессоров
+  \return Код завершения программы
  */
-static void
-operation_on_memory(
-	TraceStep *ts,
-	AbstractMemory *m,
-	StatisticsInfo *info)
+static int
+run_sweep(char **fnames, int count, int disable_cache, int threads)
 {
-	if (!ts || !m || !info) {
-		return;
-	}
-	if (ts->op == 'R') {
-		statistics_add_read(info);
-		m->ops->read(m, ts->addr, ts->size, NULL);
-		m->ops->reveal(m, ts->addr, ts->size, ts->value);
-	} else if (ts->op == 'W') {
-		statistics_add_write(info);
-		m->ops->write(m, ts->addr, ts->size, ts->value);
-	} else {
-		return;
-	}
+    Simulation **sims = calloc(count, sizeof(*sims));
+    Trace *t = trace_open(NULL, stderr);
+    int exit_code = 0;
+    if (!t) {
+        exit_code = EXIT_FAILURE;
+        goto finally;
+    }
+    for (int i = 0; i < count; i++) {
+        sims[i] = simulation_create(fnames[i], disable_cache, 1, stderr);
+        if (!sims[i]) {
+            exit_code = EXIT_FAILURE;
+            goto finally;
+        }
+    }
+    if (!threads) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (n < 1) ? 1 : (n > MAX_THREADS) ? MAX_THREADS : n;
+    }
+    if (sweep_run(sims, count, threads, t) < 0) {
+        exit_code = EXIT_FAILURE;
+        goto finally;
+    }
+    statistics_print_row_header(stdout);
+    for (int i = 0; i < count; i++) {
+        statistics_print_row(sims[i]->info, sims[i]->name, stdout);
+    }
+finally:
+    trace_close(t);
+    for (int i = 0; i < count; i++) {
+        simulation_free(sims[i]);
+    }
+    free(sims);
+    return exit_code;
+}
+
+/*!
+  Построить кривые попаданий по трассе из stdin и напечатать их
+  \param sample_rate Доля блоков в выборке, 0 - если доля не задана
+  \param sample_size Наибольшее число блоков в выборке, 0 - если не задано
+  (если не задано ни то, ни другое, кривые строятся точно)
+  \return Код завершения программы
+ */
+static int
+run_miss_ratio_curve(double sample_rate, int sample_size)
+{
+    Trace *t = trace_open(NULL, stderr);
+    if (!t) {
+        return EXIT_FAILURE;
+    }
+    MissRatioCurve *m = (sample_rate > 0 || sample_size)
+        ? mrc_create_sampled(sample_rate, sample_size) : mrc_create();
+    int r;
+    while ((r = trace_next(t)) > 0) {
+        mrc_access(m, trace_get(t));
+    }
+    if (r == 0) {
+        mrc_print(m, stdout);
+    }
+    mrc_free(m);
+    trace_close(t);
+    return (r < 0) ? EXIT_FAILURE : 0;
 }
 
 int
@@ -65,93 +124,190 @@ main(int argc, char *argv[])
     if (argc < 2) {
         return 0;
     }
-    char *fname = NULL;
-    int print_config = 0, statistics = 0;
-    int disable_cache = 0, dump_memory = 0;
+    char *convert_path = NULL;
+    char *image_path = NULL, *initial_path = NULL;
+    char *fnames[argc];
+    int print_config = 0, statistics = 0, statistics_tree = 0;
+    int disable_cache = 0, dump_memory = 0, compact_dump = 0, pipeline = 0;
+    int sweep = 0, threads = 0, miss_ratio_curve = 0, sample_size = 0;
+    double sample_rate = 0;
     int fnames_count = 0;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--print-config") == 0) {
             print_config = 1;
         } else if (strcmp(argv[i], "--statistics") == 0) {
             statistics = 1;
+        } else if (strcmp(argv[i], "--statistics-tree") == 0) {
+            statistics = statistics_tree = 1;
         } else if (strcmp(argv[i], "--disable-cache") == 0) {
             disable_cache = 1;
         } else if (strcmp(argv[i], "--dump-memory") == 0) {
             dump_memory = 1;
+        } else if (strcmp(argv[i], "--dump-memory-compact") == 0) {
+            dump_memory = compact_dump = 1;
+        } else if (strcmp(argv[i], "--dump-memory-binary") == 0) {
+            if (++i == argc) {
+                die_bad_args();
+            }
+            image_path = argv[i];
+        } else if (strcmp(argv[i], "--initial-memory") == 0) {
+            if (++i == argc) {
+                die_bad_args();
+            }
+            initial_path = argv[i];
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = 1;
+        } else if (strcmp(argv[i], "--convert-trace") == 0) {
+            if (++i == argc) {
+                die_bad_args();
+            }
+            convert_path = argv[i];
+        } else if (strcmp(argv[i], "--miss-ratio-curve") == 0) {
+            miss_ratio_curve = 1;
+        } else if (strcmp(argv[i], "--sample-rate") == 0) {
+            char *eptr = NULL;
+            if (++i == argc || !((sample_rate = strtod(argv[i], &eptr)) > 0) || *eptr
+                || sample_rate > 1)
+            {
+                die_bad_args();
+            }
+        } else if (strcmp(argv[i], "--sample-size") == 0) {
+            char *eptr = NULL;
+            if (++i == argc || (sample_size = strtol(argv[i], &eptr, 10)) <= 0 || *eptr) {
+                die_bad_args();
+            }
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            sweep = 1;
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            char *eptr = NULL;
+            if (++i == argc || (threads = strtol(argv[i], &eptr, 10)) <= 0 || *eptr
+                || threads > MAX_THREADS)
+            {
+                die_bad_args();
+            }
         } else if (argv[i][0] == '-') {
             die_bad_args();
         } else {
-            fname = argv[i];
-            fnames_count++;
+            fnames[fnames_count++] = argv[i];
         }
     }
-    if (fnames_count != 1) {
+    if ((image_path || initial_path) && (convert_path || miss_ratio_curve || sweep || print_config)) {
+        // образы ОЗУ поддерживаются только при моделировании одной конфигурации
         die_bad_args();
-    } 
-    
-    ConfigFile *cfg = config_file_parse(fname, stderr);
-    if (!cfg) {
-        fprintf(stderr, "%d\n", __LINE__);
-        return EXIT_FAILURE;
     }
+    if (convert_path) {
+        // преобразование текстовой трассы из stdin в двоичную, конфигурационный файл не нужен:
+        if (fnames_count || print_config || statistics || disable_cache || dump_memory
+            || pipeline || sweep || threads || miss_ratio_curve)
+        {
+            die_bad_args();
+        }
+        Trace *t = trace_open(NULL, stderr);
+        if (!t || trace_convert(t, convert_path) < 0) {
+            trace_close(t);
+            return EXIT_FAILURE;
+        }
+        trace_close(t);
+        return 0;
+    }
+    if (miss_ratio_curve) {
+        // кривые строятся только по трассе, конфигурационный файл не нужен:
+        if (fnames_count || print_config || statistics || disable_cache || dump_memory
+            || pipeline || sweep || threads || (sample_rate > 0 && sample_size))
+        {
+            die_bad_args();
+        }
+        return run_miss_ratio_curve(sample_rate, sample_size);
+    }
+    if (sample_rate > 0 || sample_size) {
+        die_bad_args();
+    }
+    if (sweep) {
+        // один проход по трассе для всех конфигураций, по строке статистики на конфигурацию:
+        if (!fnames_count || print_config || statistics || dump_memory || pipeline) {
+            die_bad_args();
+        }
+        return run_sweep(fnames, fnames_count, disable_cache, threads);
+    }
+    if (fnames_count != 1 || threads) {
+        die_bad_args();
+    } 
     
     if (print_config) {
-        if (statistics || disable_cache || dump_memory || !fname) {
+        if (statistics || disable_cache || dump_memory || pipeline) {
             die_bad_args();
         }
+        ConfigFile *cfg = config_file_parse(fnames[0], stderr);
+        if (!cfg) {
+            return EXIT_FAILURE;
+        }
         config_file_print(cfg);
         config_file_free(cfg);
         return 0;
     }
     
-    StatisticsInfo *info = statistics_create(cfg);
-    AbstractMemory *mem = memory_create(cfg, NULL, info);
+    Simulation *sim = simulation_create(fnames[0], disable_cache, !dump_memory && !image_path, stderr);
     Trace *t = trace_open(NULL, stderr);
-    Random *rnd = NULL;
     int r, exit_code = 0;
-    if (!mem || !t) {
+    if (!sim || !t || (initial_path && memory_load_image(sim->ram, initial_path, stderr) < 0)) {
 		exit_code = EXIT_FAILURE;
-        fprintf(stderr, "%d\n", __LINE__);
 		goto finally;
 	}
-    if (!disable_cache) {
-        info->hit_counter_needed = 1;
-        rnd = random_create(cfg);
-        mem = cache_create(cfg, NULL, info, mem, rnd);
-        if (!rnd || !mem) {
+    
+    if (pipeline) {
+        // трасса разбирается в отдельном потоке, здесь только моделирование:
+        TracePipeline *p = trace_pipeline_start(t);
+        TraceStep *steps;
+        if (!p) {
             exit_code = EXIT_FAILURE;
-            fprintf(stderr, "%d\n", __LINE__);
             goto finally;
         }
+        while ((r = trace_pipeline_next(p, &steps)) > 0) {
+            simulation_run(sim, steps, r);
+        }
+        trace_pipeline_stop(p);
+    } else {
+        // шаги накапливаются в буфере и передаются модели пачками:
+        TraceStep steps[RUN_BATCH_SIZE];
+        int count = 0;
+        while ((r = trace_next(t)) > 0) {
+            steps[count++] = *trace_get(t);
+            if (count == RUN_BATCH_SIZE) {
+                simulation_run(sim, steps, count);
+                count = 0;
+            }
+        }
+        simulation_run(sim, steps, count);
     }
+    if (r < 0) {
+        exit_code = EXIT_FAILURE;
+        goto finally;
+    }
+    simulation_finish(sim);
     
-    while ((r = trace_next(t))) {
-		if (r == -1) {
-			exit_code = EXIT_FAILURE;
-			goto finally;
-		}
-		operation_on_memory(trace_get(t), mem, info);
-	}
-    mem->ops->flush(mem);
-    
-    if (dump_memory) {
-		mem->ops->print_dump(mem, stdout);
+    if (image_path && memory_write_image(sim->ram, image_path, stderr) < 0) {
+        exit_code = EXIT_FAILURE;
+        goto finally;
+    }
+    if (compact_dump) {
+        memory_print_compact_dump(sim->ram, stdout);
+    } else if (dump_memory) {
+		sim->mem->ops->print_dump(sim->mem, stdout);
 	}
     
-    if (statistics) {
-		statistics_print(info, stdout);
+    if (statistics_tree) {
+        statistics_print_tree(sim->info, stdout);
+    } else if (statistics) {
+		statistics_print(sim->info, stdout);
 	}
+    if (memory_failed(sim->ram)) {
+        // содержимое ОЗУ (дамп или образ) неполно, хотя статистика верна:
+        exit_code = EXIT_FAILURE;
+    }
     
 finally:
 	trace_close(t);
-    statistics_free(info);
-    config_file_free(cfg);
-    if (mem) {
-		mem->ops->free(mem);
-	}
-    if (rnd) {
-        rnd->ops->free(rnd);
-    }
+    simulation_free(sim);
     return exit_code;
 }
 
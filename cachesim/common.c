@@ -38,6 +38,75 @@ error_invalid(const char *func, const char *param)
     fprintf(stderr, "Configuration parameter %s value is invalid\n", param);
 }
 
+/*!
+  Функция копирует биты маски известности по одному (общий случай несовпадающего
+  выравнивания, см. memory_cells_copy)
+ */
+static void
+memory_cells_copy_bits(MemoryCells dst, MemoryCells src, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        int s = src.bit + i, d = dst.bit + i;
+        unsigned char mask = 1 << (d % 8);
+        if ((src.known[s / 8] >> (s % 8)) & 1) {
+            dst.known[d / 8] |= mask;
+        } else {
+            dst.known[d / 8] &= ~mask;
+        }
+    }
+}
+
+void
+memory_cells_copy(MemoryCells dst, MemoryCells src, int size)
+{
+    memcpy(dst.value, src.value, size);
+    if (dst.bit || src.bit) {
+        memory_cells_copy_bits(dst, src, size);
+        return;
+    }
+    // маски выровнены на границу байта: копируем целые байты, затем остаток
+    memcpy(dst.known, src.known, size / 8);
+    if (size % 8) {
+        unsigned char mask = (1 << (size % 8)) - 1;
+        unsigned char *d = dst.known + size / 8;
+        *d = (*d & ~mask) | (src.known[size / 8] & mask);
+    }
+}
+
+unsigned char *
+memory_cells_arena_create(int count, int size)
+{
+    void *arena = NULL;
+    size_t bytes = (size_t) count * size + (size_t) count * (size / 8);
+    if (posix_memalign(&arena, CPU_CACHE_LINE, bytes) != 0) {
+        return NULL;
+    }
+    memset(arena, 0, bytes);
+    return arena;
+}
+
+void
+memory_cells_forget(MemoryCells dst, int size)
+{
+    memset(dst.value, 0, size);
+    if (dst.bit) {
+        int head = 8 - dst.bit;
+        if (head > size) {
+            head = size;
+        }
+        *dst.known &= ~(((1 << head) - 1) << dst.bit);
+        dst = memory_cells_at(dst, head);
+        size -= head;
+        if (!size) {
+            return;
+        }
+    }
+    memset(dst.known, 0, size / 8);
+    if (size % 8) {
+        dst.known[size / 8] &= ~((1 << (size % 8)) - 1);
+    }
+}
+
 /*
  * Local variables:
  *  c-basic-offset: 4
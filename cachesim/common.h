@@ -8,17 +8,24 @@
 #ifndef COMMON_H_INCLUDED
 #define COMMON_H_INCLUDED
 
-/*! Тип для представления адресов */
-typedef int memaddr_t;
+#include <stddef.h>
 
-/*! Одна ячейка памяти (один байт)
-  \brief Описание ячейки памяти
+/*! Тип для представления адресов (беззнаковый 64-битный, адресное пространство не ограничивается) */
+typedef unsigned long long memaddr_t;
+
+/*! Последовательность ячеек памяти (байтов) в упакованном виде: значения ячеек хранятся
+  подряд в массиве value, признаки известности значений - в битовой маске known
+  (по одному биту на ячейку, младшие биты байта маски соответствуют младшим адресам).
+  Начальное состояние ячейки - значение не известно (бит сброшен).
+  Структура не владеет памятью и передается по значению.
+  \brief Описание последовательности ячеек памяти
  */
-typedef struct MemoryCell
+typedef struct MemoryCells
 {
-    unsigned char value; //!< Значение ячейки
-    unsigned char flags; //!< 0, если значение не известно (начальное состояние), 1, если значение известно
-} MemoryCell;
+    unsigned char *value; //!< Значение первой ячейки, NULL - ячейки не нужны
+    unsigned char *known; //!< Байт маски, содержащий бит первой ячейки
+    int bit; //!< Номер бита первой ячейки в байте *known (0..7)
+} MemoryCells;
 
 /*! Полезные константы */
 enum
@@ -31,7 +38,7 @@ enum
 enum
 {
     PARAM_BUF_SIZE = KiB,//! Размер строкового буфера под параметр
-    MAX_ADDRESS    = GiB //! Максимальный адрес (первый недопустимый)
+    CPU_CACHE_LINE = 64 //! Размер строки кеша процессора, на которой выравниваются массивы данных
 };
 
 /*! функция формирует имя конфигурационного параметра, приписывая к основной части имени префикс имени.
@@ -60,6 +67,131 @@ void error_undefined(const char *func, const char *param);
  */
 void error_invalid(const char *func, const char *param);
 
+/*! Функция возвращает размер в байтах буфера под size ячеек (значения и маска)
+  \param size Количество ячеек
+ */
+static inline int
+memory_cells_buf_size(int size)
+{
+    return size + (size + 7) / 8;
+}
+
+/*! Функция формирует описание ячеек, размещенных в буфере размера memory_cells_buf_size(size):
+  сначала size значений, затем битовая маска
+  \param buf Буфер
+  \param size Количество ячеек
+ */
+static inline MemoryCells
+memory_cells_make(unsigned char *buf, int size)
+{
+    return (MemoryCells) { buf, buf + size, 0 };
+}
+
+/*! Функция возвращает описание последовательности, начинающейся с ячейки номер off
+  \param c Последовательность ячеек
+  \param off Номер ячейки
+ */
+static inline MemoryCells
+memory_cells_at(MemoryCells c, int off)
+{
+    int b = c.bit + off;
+    return (MemoryCells) { c.value + off, c.known + b / 8, b % 8 };
+}
+
+/*! Функция возвращает ненулевое значение, если значение ячейки номер i известно
+  \param c Последовательность ячеек
+  \param i Номер ячейки
+ */
+static inline int
+memory_cells_known(MemoryCells c, int i)
+{
+    i += c.bit;
+    return (c.known[i / 8] >> (i % 8)) & 1;
+}
+
+/*! Функция выделяет непрерывную выровненную по строке кеша процессора область под count
+  последовательностей по size ячеек (size кратно 8): сначала значения всех последовательностей,
+  затем их битовые маски. Все ячейки неизвестны. Область освобождается функцией free.
+  \param count Количество последовательностей
+  \param size Количество ячеек в последовательности
+  \return Указатель на область, NULL в случае ошибки
+ */
+unsigned char *memory_cells_arena_create(int count, int size);
+
+/*! Функция возвращает описание последовательности номер i в области memory_cells_arena_create
+  \param arena Указатель на область (NULL - последовательности не хранятся)
+  \param count Количество последовательностей в области
+  \param size Количество ячеек в последовательности
+  \param i Номер последовательности
+ */
+static inline MemoryCells
+memory_cells_arena_at(unsigned char *arena, int count, int size, int i)
+{
+    if (!arena) {
+        return (MemoryCells) { NULL, NULL, 0 };
+    }
+    return (MemoryCells) { arena + (long) i * size, arena + (long) count * size + (long) i * (size / 8), 0 };
+}
+
+/*! Функция копирует size ячеек (значения и признаки известности).
+  \param dst Куда копировать
+  \param src Откуда копировать
+  \param size Количество ячеек
+ */
+void memory_cells_copy(MemoryCells dst, MemoryCells src, int size);
+
+/*! Функция делает значения size ячеек неизвестными (значения обнуляются).
+  \param dst Последовательность ячеек
+  \param size Количество ячеек
+ */
+void memory_cells_forget(MemoryCells dst, int size);
+
+/*! Функция читает 64-битное число, записанное в порядке little-endian (двоичные форматы файлов)
+  \param p Указатель на первый байт числа
+ */
+static inline unsigned long long
+get_le64(const unsigned char *p)
+{
+    unsigned long long v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/*! Функция читает 32-битное число, записанное в порядке little-endian
+  \param p Указатель на первый байт числа
+ */
+static inline unsigned
+get_le32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+}
+
+/*! Функция записывает 64-битное число в порядке little-endian
+  \param p Указатель, куда записывается первый байт числа
+  \param v Число
+ */
+static inline void
+put_le64(unsigned char *p, unsigned long long v)
+{
+    for (int i = 0; i < 8; i++, v >>= 8) {
+        p[i] = v & 0xFF;
+    }
+}
+
+/*! Функция записывает 32-битное число в порядке little-endian
+  \param p Указатель, куда записывается первый байт числа
+  \param v Число
+ */
+static inline void
+put_le32(unsigned char *p, unsigned v)
+{
+    for (int i = 0; i < 4; i++, v >>= 8) {
+        p[i] = v & 0xFF;
+    }
+}
+
 /*! Функция, приводящая strcmp к формату, требуемому функциями stdlib.h (qsort, bsearch).
  */
 int strcmp_wrapper(const void *p1, const void *p2);
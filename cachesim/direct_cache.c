@@ -22,14 +22,11 @@ enum
 typedef struct DirectCacheBlock
 {
     memaddr_t addr; //!< Адрес по которому в основной памяти (mem) находится этот блок, NO_BLOCK - если этот блок свободен
-    MemoryCell *mem; //!< Ячейки памяти, хранящиеся в блоке кеша
     int dirty; //!< Флаг того, что блок содержит данные, не сброшенные в память, только для write back кеша
 } DirectCacheBlock;
 
-enum
-{
-    NO_BLOCK = -1 //!< Значение поля addr в случае, если блок свободен
-};
+/*! Значение поля addr в случае, если блок свободен (не бывает адресом начала блока) */
+#define NO_BLOCK ((memaddr_t) -1)
 
 struct DirectCache;
 typedef struct DirectCache DirectCache;
@@ -60,13 +57,27 @@ struct DirectCache
     DirectCacheOps direct_ops; //!< Дополнительные операции кеша прямого отображения
     DirectCacheBlock *blocks; //!< Блоки кеша
     AbstractMemory *mem; //!< Нижележащая память
+    unsigned char *data; //!< Ячейки памяти, хранящиеся в блоках кеша (см. memory_cells_arena_create), NULL - кеш не хранит данные
     int cache_size; //!< Размер кеша (считывается из конф. файла)
     int block_size; //!< Размер одного блока кеша (считывается из конф. файла)
     int block_count; //!< Количество блоков кеша
+    int index_mask; //!< block_count - 1 (используется специализированными ядрами, см. direct_cache_kernel_ops)
     int cache_read_time; //!< Время выполнения чтения из кеша (считывается из конф. файла)
     int cache_write_time; //!< Время выполнения записи в кеш (считывается из конф. файла)
 };
 
+/*!
+  Получить ячейки памяти, хранящиеся в блоке кеша
+  \param c Указатель на структуру описания модели кеша
+  \param b Указатель на блок кеша
+  \return Ячейки блока (с value == NULL, если кеш не хранит данные)
+ */
+static inline MemoryCells
+direct_cache_cells(const DirectCache *c, const DirectCacheBlock *b)
+{
+    return memory_cells_arena_at(c->data, c->block_count, c->block_size, b - c->blocks);
+}
+
 /*!
   Освободить ресурсы
   \param m Указатель на структуру описания модели кеша прямого отображения (в виде указателя на базовую структуру)
@@ -80,9 +91,7 @@ direct_cache_free(AbstractMemory *m)
         if (c->mem) {
             c->mem->ops->free(c->mem);
         }
-        for (int i = 0; i < c->block_count; i++) {
-            free(c->blocks[i].mem);
-        }
+        free(c->data);
         free(c->blocks);
         free(c);
     }
@@ -103,6 +112,31 @@ direct_cache_find(DirectCache *c, memaddr_t aligned_addr)
     return &c->blocks[index];
 }
 
+/*!
+  Загрузить блок из нижележащей памяти, учитывая затраченные на это такты
+  \param c Указатель на структуру описания модели кеша прямого отображения
+  \param b Указатель на блок кеша с уже установленным адресом
+  \param size Размер блока
+ */
+static inline void
+direct_cache_load(DirectCache *c, DirectCacheBlock *b, int size)
+{
+    long long start = statistics_clock(c->b.info);
+    c->mem->ops->read(c->mem, b->addr, size, direct_cache_cells(c, b));
+    statistics_add_fill_clock(c->b.info, statistics_clock(c->b.info) - start);
+}
+
+/*!
+  Записать ячейки в нижележащую память при сквозной записи, учитывая затраченные на это такты
+ */
+static inline void
+direct_cache_write_through(DirectCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    long long start = statistics_clock(c->b.info);
+    c->mem->ops->write(c->mem, addr, size, src);
+    statistics_add_write_through_clock(c->b.info, statistics_clock(c->b.info) - start);
+}
+
 /*!
   Поместить блок ОЗУ в кеш прямого отображения
   \param c Указатель на структуру описания модели кеша прямого отображения
@@ -115,13 +149,45 @@ direct_cache_place(DirectCache *c, memaddr_t aligned_addr)
     int index = (aligned_addr / c->block_size) % c->block_count;
     DirectCacheBlock *b = &c->blocks[index];
     if (b->addr != NO_BLOCK) {
+        statistics_add_eviction_counter(c->b.info);
         c->direct_ops.finalize(c, b);
     }
     b->addr = aligned_addr;
-    c->mem->ops->read(c->mem, b->addr, c->block_size, b->mem);
+    direct_cache_load(c, b, c->block_size);
+    return b;
+}
+
+/*!
+  Найти блок кеша прямого отображения, содержащий адрес, при промахе поместить блок в кеш
+  \param c Указатель на структуру описания модели кеша прямого отображения
+  \param aligned_addr Адрес начала блока
+  \param p_hit Сюда записывается 1 в случае попадания и 0 в случае промаха
+  \return Указатель на блок кеша, содержащий адрес aligned_addr
+ */
+static inline DirectCacheBlock *
+direct_cache_fetch(DirectCache *c, memaddr_t aligned_addr, int *p_hit)
+{
+    DirectCacheBlock *b = direct_cache_find(c, aligned_addr);
+    *p_hit = (b != NULL);
+    if (!b) {
+        b = direct_cache_place(c, aligned_addr);
+    }
     return b;
 }
 
+/*!
+  Поместить прочитанное содержимое ячеек в блок кеша и "раскрыть" его в нижележащей памяти
+  (если кеш хранит данные)
+ */
+static inline void
+direct_cache_reveal_block(DirectCache *c, DirectCacheBlock *b, memaddr_t addr, int size, MemoryCells src)
+{
+    if (c->data) {
+        memory_cells_copy(memory_cells_at(direct_cache_cells(c, b), addr - b->addr), src, size);
+        c->mem->ops->reveal(c->mem, addr, size, src);
+    }
+}
+
 /*!
   Прочитать ячейки из кеша прямого отображения
   \param m Указатель на структуру описания модели кеша прямого отображения (в виде указателя на базовую структуру)
@@ -134,23 +200,81 @@ direct_cache_read(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    MemoryCell *dst)
+    MemoryCells dst)
 {
     DirectCache *c = (DirectCache*) m;
     memaddr_t aligned_addr = addr & -c->block_size;
-    statistics_add_counter(c->b.info, c->cache_read_time);
-    DirectCacheBlock *b = direct_cache_find(c, aligned_addr);
-    if (b) {
-        statistics_add_hit_counter(c->b.info);
-    } else {
-        b = direct_cache_place(c, aligned_addr);
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    DirectCacheBlock *b = direct_cache_fetch(c, aligned_addr, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
     }
-    if (dst) {
+    if (dst.value) {
 		// выполняем копирование данных:
-		memcpy(dst, b->mem + (addr - aligned_addr), size * sizeof(b->mem[0]));
+		memory_cells_copy(dst, memory_cells_at(direct_cache_cells(c, b), addr - aligned_addr), size);
 	}
 }
 
+/*!
+  Прочитать ячейки из кеша прямого отображения и "раскрыть" их содержимое
+  (то же, что read и reveal, но с одним поиском блока в кеше)
+  \param m Указатель на структуру описания модели кеша прямого отображения (в виде указателя на базовую структуру)
+  \param addr Адрес в кеше прямого отображения
+  \param size Количество считываемых ячеек
+  \param src Прочитанное содержимое ячеек
+ */
+static void
+direct_cache_read_reveal(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells src)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    DirectCacheBlock *b = direct_cache_fetch(c, addr & -c->block_size, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    direct_cache_reveal_block(c, b, addr, size, src);
+}
+
+/*!
+  Выполнить пачку шагов чтения (см. read_batch), накапливая статистику в локальных переменных
+ */
+static void
+direct_cache_read_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        int hit;
+        DirectCacheBlock *b = direct_cache_fetch(c, steps[i].addr & -c->block_size, &hit);
+        hits += hit;
+        direct_cache_reveal_block(c, b, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_reads(c->b.info, count, (long long) count * c->cache_read_time);
+    statistics_add_hit_counters(c->b.info, hits, (long long) hits * c->cache_read_time);
+}
+
+/*!
+  Записать ячейки в кеш со сквозной записью, не учитывая время записи в кеш
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline int
+direct_cache_wt_store(DirectCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    memaddr_t aligned_addr = addr & -c->block_size;
+    DirectCacheBlock *b = direct_cache_find(c, aligned_addr);
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(direct_cache_cells(c, b), addr - aligned_addr), src, size);
+    }
+    direct_cache_write_through(c, addr, size, src);
+    return b != NULL;
+}
+
 /*!
   Функция записи в кеш прямого отображения в случае сквозной записи
   \param m Указатель на структуру описания модели кеша прямого отображения (в виде указателя на базовую структуру)
@@ -163,16 +287,45 @@ direct_cache_wt_write(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    const MemoryCell *src)
+    MemoryCells src)
+{
+    DirectCache *c = (DirectCache*) m;
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (direct_cache_wt_store(c, addr, size, src)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
+    }
+}
+
+/*!
+  Выполнить пачку шагов записи в кеш со сквозной записью (см. write_batch)
+ */
+static void
+direct_cache_wt_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
 {
     DirectCache *c = (DirectCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += direct_cache_wt_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
+}
+
+/*!
+  Записать ячейки в кеш с отложенной записью, не учитывая время записи в кеш
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline int
+direct_cache_wb_store(DirectCache *c, memaddr_t addr, int size, MemoryCells src)
+{
     memaddr_t aligned_addr = addr & -c->block_size;
-    DirectCacheBlock *b = direct_cache_find(c, aligned_addr);
-    statistics_add_counter(c->b.info, c->cache_write_time);
-    if (b) {
-        memcpy(b->mem + (addr - aligned_addr), src, size * sizeof(b->mem[0]));
+    int hit;
+    DirectCacheBlock *b = direct_cache_fetch(c, aligned_addr, &hit);
+    if (c->data) {
+        memory_cells_copy(memory_cells_at(direct_cache_cells(c, b), addr - aligned_addr), src, size);
     }
-    c->mem->ops->write(c->mem, addr, size, src);
+    b->dirty = 1;
+    return hit;
 }
 
 /*!
@@ -187,17 +340,28 @@ direct_cache_wb_write(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    const MemoryCell *src)
+    MemoryCells src)
 {
     DirectCache *c = (DirectCache*) m;
-    memaddr_t aligned_addr = addr & -c->block_size;
-    statistics_add_counter(c->b.info, c->cache_write_time);
-    DirectCacheBlock *b = direct_cache_find(c, aligned_addr);
-    if (!b) {
-        b = direct_cache_place(c, aligned_addr);
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (direct_cache_wb_store(c, addr, size, src)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
     }
-    memcpy(b->mem + (addr - aligned_addr), src, size * sizeof(b->mem[0]));
-    b->dirty = 1;
+}
+
+/*!
+  Выполнить пачку шагов записи в кеш с отложенной записью (см. write_batch)
+ */
+static void
+direct_cache_wb_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += direct_cache_wb_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
 }
 
 /*!
@@ -212,13 +376,13 @@ direct_cache_reveal(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    const MemoryCell *src)
+    MemoryCells src)
 {
     DirectCache *c = (DirectCache*) m;
     memaddr_t aligned_addr = addr & -c->block_size;
     DirectCacheBlock *b = direct_cache_find(c, aligned_addr);
-    if (b) {
-        memcpy(b->mem + (addr - aligned_addr), src, size * sizeof(b->mem[0]));
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(direct_cache_cells(c, b), addr - aligned_addr), src, size);
     }
     c->mem->ops->reveal(c->mem, addr, size, src);
 }
@@ -239,8 +403,10 @@ static void
 direct_cache_wb_finalize(DirectCache *c, DirectCacheBlock *b)
 {
     if (b->dirty) {
+        long long start = statistics_clock(c->b.info);
         statistics_add_write_back_counter(c->b.info);
-        c->mem->ops->write(c->mem, b->addr, c->block_size, b->mem);
+        c->mem->ops->write(c->mem, b->addr, c->block_size, direct_cache_cells(c, b));
+        statistics_add_write_back_clock(c->b.info, statistics_clock(c->b.info) - start);
         b->dirty = 0;
     }
 }
@@ -280,6 +446,9 @@ static AbstractMemoryOps direct_cache_wt_ops =
     direct_cache_read,
     direct_cache_wt_write,
     direct_cache_reveal,
+    direct_cache_read_reveal,
+    direct_cache_read_batch,
+    direct_cache_wt_write_batch,
     direct_cache_flush,
     direct_cache_print_dump
 };
@@ -290,10 +459,282 @@ static AbstractMemoryOps direct_cache_wb_ops =
     direct_cache_read,
     direct_cache_wb_write,
     direct_cache_reveal,
+    direct_cache_read_reveal,
+    direct_cache_read_batch,
+    direct_cache_wb_write_batch,
     direct_cache_flush,
     direct_cache_print_dump
 };
 
+/*
+  Специализированные ядра одиночных и пакетных операций. Размер блока и стратегия записи в них -
+  константы, поэтому индекс блока вычисляется сдвигом и маской, а финализация вытесняемого блока
+  встраивается. Одиночные операции нужны кешам нижних уровней и раздельным кешам, которые
+  получают обращения по одному. Ядра применимы, если число блоков кеша - степень двойки;
+  в остальных случаях используются общие операции direct_cache_wt_ops и direct_cache_wb_ops.
+ */
+
+/*!
+  Найти блок, содержащий адрес, при промахе поместить блок в кеш (см. direct_cache_fetch)
+  \param block_shift Логарифм размера блока
+  \param write_back Ненулевое значение для кеша с отложенной записью
+ */
+static inline __attribute__((always_inline)) DirectCacheBlock *
+direct_cache_kernel_fetch(DirectCache *c, memaddr_t addr, int block_shift, int write_back, int *p_hit)
+{
+    memaddr_t aligned_addr = addr & -(1 << block_shift);
+    DirectCacheBlock *b = &c->blocks[(aligned_addr >> block_shift) & c->index_mask];
+    *p_hit = (b->addr == aligned_addr);
+    if (!*p_hit) {
+        if (b->addr != NO_BLOCK) {
+            statistics_add_eviction_counter(c->b.info);
+            if (write_back) {
+                direct_cache_wb_finalize(c, b);
+            }
+        }
+        b->addr = aligned_addr;
+        direct_cache_load(c, b, 1 << block_shift);
+    }
+    return b;
+}
+
+/*!
+  Записать ячейки в кеш, не учитывая время записи в кеш (см. direct_cache_wt_store и direct_cache_wb_store)
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline __attribute__((always_inline)) int
+direct_cache_kernel_store(DirectCache *c, memaddr_t addr, int size, MemoryCells src, int block_shift, int write_back)
+{
+    DirectCacheBlock *b;
+    int hit;
+    if (write_back) {
+        b = direct_cache_kernel_fetch(c, addr, block_shift, write_back, &hit);
+        b->dirty = 1;
+    } else {
+        // при сквозной записи блок в кеш не помещается, только обновляется:
+        b = &c->blocks[(addr >> block_shift) & c->index_mask];
+        hit = (b->addr == (addr & -(1 << block_shift)));
+        if (!hit) {
+            b = NULL;
+        }
+    }
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(direct_cache_cells(c, b), addr - b->addr), src, size);
+    }
+    if (!write_back) {
+        direct_cache_write_through(c, addr, size, src);
+    }
+    return hit;
+}
+
+/*!
+  Ядро чтения (см. direct_cache_read)
+ */
+static inline __attribute__((always_inline)) void
+direct_cache_kernel_read(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst, int block_shift, int write_back)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    DirectCacheBlock *b = direct_cache_kernel_fetch(c, addr, block_shift, write_back, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    if (dst.value) {
+        memory_cells_copy(dst, memory_cells_at(direct_cache_cells(c, b), addr - b->addr), size);
+    }
+}
+
+/*!
+  Ядро чтения с "раскрытием" (см. direct_cache_read_reveal)
+ */
+static inline __attribute__((always_inline)) void
+direct_cache_kernel_read_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src, int block_shift, int write_back)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    DirectCacheBlock *b = direct_cache_kernel_fetch(c, addr, block_shift, write_back, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    direct_cache_reveal_block(c, b, addr, size, src);
+}
+
+/*!
+  Ядро записи (см. direct_cache_wt_write и direct_cache_wb_write)
+ */
+static inline __attribute__((always_inline)) void
+direct_cache_kernel_write(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src, int block_shift, int write_back)
+{
+    DirectCache *c = (DirectCache*) m;
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (direct_cache_kernel_store(c, addr, size, src, block_shift, write_back)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
+    }
+}
+
+/*!
+  Ядро "раскрытия" (см. direct_cache_reveal)
+ */
+static inline __attribute__((always_inline)) void
+direct_cache_kernel_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src, int block_shift)
+{
+    DirectCache *c = (DirectCache*) m;
+    DirectCacheBlock *b = &c->blocks[(addr >> block_shift) & c->index_mask];
+    if (b->addr == (addr & -(1 << block_shift)) && c->data) {
+        memory_cells_copy(memory_cells_at(direct_cache_cells(c, b), addr - b->addr), src, size);
+    }
+    c->mem->ops->reveal(c->mem, addr, size, src);
+}
+
+/*!
+  Ядро пакетного чтения (см. direct_cache_read_batch)
+ */
+static inline __attribute__((always_inline)) void
+direct_cache_kernel_read_batch(AbstractMemory *m, const TraceStep *steps, int count, int block_shift, int write_back)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        int hit;
+        DirectCacheBlock *b = direct_cache_kernel_fetch(c, steps[i].addr, block_shift, write_back, &hit);
+        hits += hit;
+        direct_cache_reveal_block(c, b, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_reads(c->b.info, count, (long long) count * c->cache_read_time);
+    statistics_add_hit_counters(c->b.info, hits, (long long) hits * c->cache_read_time);
+}
+
+/*!
+  Ядро пакетной записи (см. direct_cache_wt_write_batch и direct_cache_wb_write_batch)
+ */
+static inline __attribute__((always_inline)) void
+direct_cache_kernel_write_batch(AbstractMemory *m, const TraceStep *steps, int count, int block_shift, int write_back)
+{
+    DirectCache *c = (DirectCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += direct_cache_kernel_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]),
+            block_shift, write_back);
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
+}
+
+/*!
+  Определить одиночные и пакетные операции и таблицы операций для заданного размера блока
+ */
+#define DIRECT_CACHE_KERNELS(BLOCK_SIZE, BLOCK_SHIFT)                                     \
+static void                                                                               \
+direct_cache_wt_read_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst) \
+{                                                                                         \
+    direct_cache_kernel_read(m, addr, size, dst, BLOCK_SHIFT, 0);                         \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wt_read_reveal_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    direct_cache_kernel_read_reveal(m, addr, size, src, BLOCK_SHIFT, 0);                  \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wt_write_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    direct_cache_kernel_write(m, addr, size, src, BLOCK_SHIFT, 0);                        \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wb_read_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst) \
+{                                                                                         \
+    direct_cache_kernel_read(m, addr, size, dst, BLOCK_SHIFT, 1);                         \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wb_read_reveal_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    direct_cache_kernel_read_reveal(m, addr, size, src, BLOCK_SHIFT, 1);                  \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wb_write_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    direct_cache_kernel_write(m, addr, size, src, BLOCK_SHIFT, 1);                        \
+}                                                                                         \
+static void                                                                               \
+direct_cache_reveal_##BLOCK_SIZE(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    direct_cache_kernel_reveal(m, addr, size, src, BLOCK_SHIFT);                          \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wt_read_batch_##BLOCK_SIZE(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    direct_cache_kernel_read_batch(m, steps, count, BLOCK_SHIFT, 0);                      \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wb_read_batch_##BLOCK_SIZE(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    direct_cache_kernel_read_batch(m, steps, count, BLOCK_SHIFT, 1);                      \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wt_write_batch_##BLOCK_SIZE(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    direct_cache_kernel_write_batch(m, steps, count, BLOCK_SHIFT, 0);                     \
+}                                                                                         \
+static void                                                                               \
+direct_cache_wb_write_batch_##BLOCK_SIZE(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    direct_cache_kernel_write_batch(m, steps, count, BLOCK_SHIFT, 1);                     \
+}                                                                                         \
+static AbstractMemoryOps direct_cache_wt_ops_##BLOCK_SIZE =                               \
+{                                                                                         \
+    direct_cache_free,                                                                    \
+    direct_cache_wt_read_##BLOCK_SIZE,                                                    \
+    direct_cache_wt_write_##BLOCK_SIZE,                                                   \
+    direct_cache_reveal_##BLOCK_SIZE,                                                     \
+    direct_cache_wt_read_reveal_##BLOCK_SIZE,                                             \
+    direct_cache_wt_read_batch_##BLOCK_SIZE,                                              \
+    direct_cache_wt_write_batch_##BLOCK_SIZE,                                             \
+    direct_cache_flush,                                                                   \
+    direct_cache_print_dump                                                               \
+};                                                                                        \
+static AbstractMemoryOps direct_cache_wb_ops_##BLOCK_SIZE =                               \
+{                                                                                         \
+    direct_cache_free,                                                                    \
+    direct_cache_wb_read_##BLOCK_SIZE,                                                    \
+    direct_cache_wb_write_##BLOCK_SIZE,                                                   \
+    direct_cache_reveal_##BLOCK_SIZE,                                                     \
+    direct_cache_wb_read_reveal_##BLOCK_SIZE,                                             \
+    direct_cache_wb_read_batch_##BLOCK_SIZE,                                              \
+    direct_cache_wb_write_batch_##BLOCK_SIZE,                                             \
+    direct_cache_flush,                                                                   \
+    direct_cache_print_dump                                                               \
+};
+
+DIRECT_CACHE_KERNELS(16, 4)
+DIRECT_CACHE_KERNELS(32, 5)
+DIRECT_CACHE_KERNELS(64, 6)
+
+/*!
+  Выбрать таблицу операций со специализированными ядрами
+  \param c Указатель на структуру описания модели кеша прямого отображения
+  (размер блока, число блоков и стратегия записи уже заданы)
+  \return Указатель на таблицу операций, NULL - если специализированного ядра нет
+ */
+static AbstractMemoryOps *
+direct_cache_kernel_ops(const DirectCache *c)
+{
+    int write_back = (c->b.ops == &direct_cache_wb_ops);
+    if (c->block_count & (c->block_count - 1)) {
+        return NULL;
+    }
+    switch (c->block_size) {
+    case 16:
+        return write_back ? &direct_cache_wb_ops_16 : &direct_cache_wt_ops_16;
+    case 32:
+        return write_back ? &direct_cache_wb_ops_32 : &direct_cache_wt_ops_32;
+    case 64:
+        return write_back ? &direct_cache_wb_ops_64 : &direct_cache_wt_ops_64;
+    default:
+        return NULL;
+    }
+}
+
 static inline int
 is_correct_block_size(int block_size)
 {
@@ -314,7 +755,8 @@ direct_cache_create(
     const char *var_prefix,
     StatisticsInfo *info,
     AbstractMemory *mem,
-    Random *rnd)
+    Random *rnd,
+    int tag_only)
 {
     char buf[PARAM_BUF_SIZE];
     DirectCache *c = (DirectCache*) calloc(1, sizeof(*c));
@@ -396,10 +838,23 @@ direct_cache_create(
     
     //выделяем блоки кэша:
     c->block_count = c->cache_size / c->block_size;
+    if (!tag_only) {
+        c->data = memory_cells_arena_create(c->block_count, c->block_size);
+        // без области данных кеш не хранил бы значения и терял бы их по пути в ОЗУ:
+        if (!c->data) {
+            fprintf(stderr, "direct_cache_create: out of memory\n");
+            goto direct_cache_create_failed;
+        }
+    }
     c->blocks = calloc(c->block_count, sizeof(*c->blocks));
     for (int i = 0; i < c->block_count; i++) {
         c->blocks[i].addr = NO_BLOCK;
-        c->blocks[i].mem = calloc(c->block_size, sizeof(c->blocks[i].mem[0]));
+    }
+    // при подходящей геометрии пакетные операции выполняются специализированными ядрами:
+    c->index_mask = c->block_count - 1;
+    AbstractMemoryOps *kernel_ops = direct_cache_kernel_ops(c);
+    if (kernel_ops) {
+        c->b.ops = kernel_ops;
     }
 
     return (AbstractMemory*) c;
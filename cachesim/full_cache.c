@@ -1,6 +1,7 @@
 /* -*- mode:c; coding: utf-8 -*- */
 
 #include "full_cache.h"
+#include "lfu.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -21,14 +22,19 @@ enum
  */
 typedef struct FullCacheBlock
 {
-    memaddr_t addr; //!< Адрес по которому в основной памяти (mem) находится этот блок, NO_BLOCK - если этот блок свободен
-    MemoryCell *mem; //!< Ячейки памяти, хранящиеся в блоке кеша
     int dirty; //!< Флаг того, что блок содержит данные, не сброшенные в память, только для write back кеша
+    int prev; //!< Номер предыдущего (использованного позже) блока в списке LRU или LFU, NO_INDEX - нет такого
+    int next; //!< Номер следующего (использованного раньше) блока в списке LRU или LFU, NO_INDEX - нет такого
+    int lfu_count; //!< Счетчик обращений LFU на момент эпохи lfu_epoch
+    unsigned long long lfu_epoch; //!< Эпоха LFU последнего обращения к блоку
 } FullCacheBlock;
 
+/*! Значение тега в случае, если блок свободен (не бывает адресом начала блока) */
+#define NO_BLOCK ((memaddr_t) -1)
+
 enum
 {
-    NO_BLOCK = -1 //!< Значение поля addr в случае, если блок свободен
+    NO_INDEX = -1 //!< Значение пустой ячейки хеш-таблицы
 };
 
 struct FullCache;
@@ -56,6 +62,13 @@ typedef struct FullCacheOps
      \return Указатель на соответствующий блок кеша
     */
     FullCacheBlock *(*cache_place)(FullCache *c, memaddr_t aligned_addr);
+
+    /*!
+     Учесть обращение к блоку, уже находящемуся в кеше
+     \param c Указатель на структуру описания модели полноассоциативного кеша
+     \param b Указатель на блок, к которому выполнено обращение
+    */
+    void (*touch)(FullCache *c, FullCacheBlock *b);
 } FullCacheOps;
 
 /*!
@@ -68,14 +81,53 @@ struct FullCache
     FullCacheOps full_ops; //!< Дополнительные операции полноассоциативного кеша
     Random *rnd; //!< Элемент случайности
     FullCacheBlock *blocks; //!< Блоки кеша
+    memaddr_t *tags; //!< Адреса, по которым в основной памяти находятся блоки (теги), NO_BLOCK - блок свободен
     AbstractMemory *mem; //!< Нижележащая память
+    unsigned char *data; //!< Ячейки памяти, хранящиеся в блоках кеша (см. memory_cells_arena_create), NULL - кеш не хранит данные
     int cache_size; //!< Размер кеша (считывается из конф. файла)
     int block_size; //!< Размер одного блока кеша (считывается из конф. файла)
     int block_count; //!< Количество блоков кеша
+    int *index; //!< Хеш-таблица с открытой адресацией: номера занятых блоков, NO_INDEX - пустая ячейка
+    int index_mask; //!< Размер хеш-таблицы (степень двойки) минус 1
+    int index_shift; //!< Сдвиг, выделяющий номер ячейки хеш-таблицы из 64-битного хеша
+    int *free_blocks; //!< Стек номеров свободных блоков (на вершине - блок с наименьшим номером)
+    int free_count; //!< Количество свободных блоков
+    int lru_head; //!< Номер последнего использованного блока (голова списка LRU)
+    int lru_tail; //!< Номер дольше всех не использовавшегося блока (хвост списка LRU)
+    LfuConfig lfu; //!< Параметры стратегии LFU
+    int *lfu_buckets; //!< Кольцевые списки блоков с равным счетчиком LFU (номер головы, NO_INDEX - пустой список)
+    int lfu_min; //!< Нижняя граница счетчиков LFU занятых блоков
+    int lfu_max; //!< Верхняя граница счетчиков LFU занятых блоков
+    int lfu_refs; //!< Число обращений с начала текущей эпохи LFU
+    unsigned long long lfu_epoch; //!< Текущая эпоха LFU (число выполненных старений)
     int cache_read_time; //!< Время выполнения чтения из кеша (считывается из конф. файла)
     int cache_write_time; //!< Время выполнения записи в кеш (считывается из конф. файла)
 };
 
+/*!
+  Получить ячейки памяти, хранящиеся в блоке кеша
+  \param c Указатель на структуру описания модели кеша
+  \param b Указатель на блок кеша
+  \return Ячейки блока (с value == NULL, если кеш не хранит данные)
+ */
+static inline MemoryCells
+full_cache_cells(const FullCache *c, const FullCacheBlock *b)
+{
+    return memory_cells_arena_at(c->data, c->block_count, c->block_size, b - c->blocks);
+}
+
+/*!
+  Получить тег (адрес блока ОЗУ) блока кеша
+  \param c Указатель на структуру описания модели кеша
+  \param b Указатель на блок кеша
+  \return Указатель на элемент массива тегов, соответствующий блоку
+ */
+static inline memaddr_t *
+full_cache_tag(const FullCache *c, const FullCacheBlock *b)
+{
+    return &c->tags[b - c->blocks];
+}
+
 /*!
   Освободить ресурсы
   \param m Указатель на структуру описания модели полноассоциативного кеша (в виде указателя на базовую структуру)
@@ -89,15 +141,66 @@ full_cache_free(AbstractMemory *m)
         if (c->mem) {
             c->mem->ops->free(c->mem);
         }
-        for (int i = 0; i < c->block_count; i++) {
-            free(c->blocks[i].mem);
-        }
+        free(c->data);
+        free(c->tags);
         free(c->blocks);
+        free(c->index);
+        free(c->free_blocks);
+        free(c->lfu_buckets);
         free(c);
     }
     return NULL;
 }
 
+/*!
+  Вычислить ячейку хеш-таблицы, с которой начинается поиск блока (мультипликативное хеширование)
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param aligned_addr Адрес начала блока
+  \return Номер ячейки хеш-таблицы
+ */
+static inline int
+full_cache_hash(const FullCache *c, memaddr_t aligned_addr)
+{
+    return (aligned_addr * 0x9E3779B97F4A7C15ULL) >> c->index_shift;
+}
+
+/*!
+  Искать ячейку хеш-таблицы, хранящую номер блока с указанным адресом
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Номер ячейки хеш-таблицы: либо хранящей искомый блок, либо пустой
+ */
+static inline int
+full_cache_index_slot(const FullCache *c, memaddr_t aligned_addr)
+{
+    int i = full_cache_hash(c, aligned_addr);
+    while (c->index[i] != NO_INDEX && c->tags[c->index[i]] != aligned_addr) {
+        i = (i + 1) & c->index_mask;
+    }
+    return i;
+}
+
+/*!
+  Удалить блок из хеш-таблицы. Последующие элементы цепочки сдвигаются назад,
+  поэтому удаленных ячеек в таблице не бывает.
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param aligned_addr Адрес начала удаляемого блока (блок обязан быть в таблице)
+ */
+static void
+full_cache_index_remove(FullCache *c, memaddr_t aligned_addr)
+{
+    int i = full_cache_index_slot(c, aligned_addr);
+    for (int j = (i + 1) & c->index_mask; c->index[j] != NO_INDEX; j = (j + 1) & c->index_mask) {
+        int home = full_cache_hash(c, c->tags[c->index[j]]);
+        // элемент можно сдвинуть в i, если его начальная ячейка не лежит циклически в (i, j]:
+        if (((j - home) & c->index_mask) >= ((j - i) & c->index_mask)) {
+            c->index[i] = c->index[j];
+            i = j;
+        }
+    }
+    c->index[i] = NO_INDEX;
+}
+
 /*!
   Искать блок ОЗУ в полноассоциативном кеше
   \param c Указатель на структуру описания модели полноассоциативного кеша
@@ -107,16 +210,52 @@ full_cache_free(AbstractMemory *m)
 static FullCacheBlock *
 full_cache_find(FullCache *c, memaddr_t aligned_addr)
 {
-    for (int i = 0; i < c->block_count; i++) {
-        if (c->blocks[i].addr == aligned_addr) {
-            return &c->blocks[i];
-        }
-    }
-    return NULL;
+    int n = c->index[full_cache_index_slot(c, aligned_addr)];
+    return (n == NO_INDEX) ? NULL : &c->blocks[n];
+}
+
+/*!
+  Освободить занятый блок кеша, синхронизировав его с памятью
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param b Указатель на вытесняемый блок
+ */
+static void
+full_cache_evict(FullCache *c, FullCacheBlock *b)
+{
+    statistics_add_eviction_counter(c->b.info);
+    c->full_ops.finalize(c, b);
+    full_cache_index_remove(c, *full_cache_tag(c, b));
+}
+
+/*!
+  Загрузить блок ОЗУ в свободный блок кеша
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param b Указатель на блок кеша
+  \param aligned_addr Адрес начала загружаемого блока
+ */
+static void
+full_cache_fill(FullCache *c, FullCacheBlock *b, memaddr_t aligned_addr)
+{
+    *full_cache_tag(c, b) = aligned_addr;
+    c->index[full_cache_index_slot(c, aligned_addr)] = b - c->blocks;
+    long long start = statistics_clock(c->b.info);
+    c->mem->ops->read(c->mem, *full_cache_tag(c, b), c->block_size, full_cache_cells(c, b));
+    statistics_add_fill_clock(c->b.info, statistics_clock(c->b.info) - start);
+}
+
+/*!
+  Записать ячейки в нижележащую память при сквозной записи, учитывая затраченные на это такты
+ */
+static inline void
+full_cache_write_through(FullCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    long long start = statistics_clock(c->b.info);
+    c->mem->ops->write(c->mem, addr, size, src);
+    statistics_add_write_through_clock(c->b.info, statistics_clock(c->b.info) - start);
 }
 
 /*!
-  Поместить блок ОЗУ в полноассоциативный кеш
+  Поместить блок ОЗУ в полноассоциативный кеш, вытесняя при необходимости случайный блок
   \param c Указатель на структуру описания модели полноассоциативного кеша
   \param aligned_addr Адрес начала искомого блока
   \return Указатель на соответствующий блок кеша
@@ -124,23 +263,276 @@ full_cache_find(FullCache *c, memaddr_t aligned_addr)
 static FullCacheBlock *
 full_cache_random_place(FullCache *c, memaddr_t aligned_addr)
 {  
-    FullCacheBlock *b = NULL;
-    for (int i = 0; i < c->block_count; i++) {
-        if (c->blocks[i].addr == NO_BLOCK) {
-            b = &c->blocks[i];
-            break;
-        }
-    }
-    if (!b) {
+    FullCacheBlock *b;
+    if (c->free_count) {
+        b = &c->blocks[c->free_blocks[--c->free_count]];
+    } else {
         int random_index = c->rnd->ops->next(c->rnd, c->block_count);
         b = &c->blocks[random_index];
-        c->full_ops.finalize(c, b);
+        full_cache_evict(c, b);
+    }
+    full_cache_fill(c, b, aligned_addr);
+    return b;
+}
+
+/*!
+  Учет обращения к блоку при случайном замещении (ничего не делает)
+ */
+static void
+full_cache_random_touch(FullCache *c, FullCacheBlock *b)
+{
+    return;
+}
+
+/*!
+  Исключить блок из списка LRU
+ */
+static inline void
+full_cache_lru_unlink(FullCache *c, FullCacheBlock *b)
+{
+    if (b->prev == NO_INDEX) {
+        c->lru_head = b->next;
+    } else {
+        c->blocks[b->prev].next = b->next;
+    }
+    if (b->next == NO_INDEX) {
+        c->lru_tail = b->prev;
+    } else {
+        c->blocks[b->next].prev = b->prev;
+    }
+}
+
+/*!
+  Поместить блок в голову списка LRU
+ */
+static inline void
+full_cache_lru_push(FullCache *c, FullCacheBlock *b)
+{
+    int n = b - c->blocks;
+    b->prev = NO_INDEX;
+    b->next = c->lru_head;
+    if (c->lru_head == NO_INDEX) {
+        c->lru_tail = n;
+    } else {
+        c->blocks[c->lru_head].prev = n;
+    }
+    c->lru_head = n;
+}
+
+/*!
+  Поместить блок ОЗУ в полноассоциативный кеш, вытесняя при необходимости
+  дольше всех не использовавшийся блок
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Указатель на соответствующий блок кеша
+ */
+static FullCacheBlock *
+full_cache_lru_place(FullCache *c, memaddr_t aligned_addr)
+{
+    FullCacheBlock *b;
+    if (c->free_count) {
+        b = &c->blocks[c->free_blocks[--c->free_count]];
+    } else {
+        b = &c->blocks[c->lru_tail];
+        full_cache_evict(c, b);
+        full_cache_lru_unlink(c, b);
+    }
+    full_cache_fill(c, b, aligned_addr);
+    full_cache_lru_push(c, b);
+    return b;
+}
+
+/*!
+  Учет обращения к блоку при замещении LRU: блок переносится в голову списка
+ */
+static void
+full_cache_lru_touch(FullCache *c, FullCacheBlock *b)
+{
+    if (c->lru_head != b - c->blocks) {
+        full_cache_lru_unlink(c, b);
+        full_cache_lru_push(c, b);
+    }
+}
+
+/*!
+  Исключить блок из кольцевого списка LFU
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param b Указатель на блок
+  \param count Текущее значение счетчика блока (номер списка)
+ */
+static inline void
+full_cache_lfu_unlink(FullCache *c, FullCacheBlock *b, int count)
+{
+    int n = b - c->blocks;
+    if (b->next == n) {
+        c->lfu_buckets[count] = NO_INDEX;
+        return;
+    }
+    c->blocks[b->prev].next = b->next;
+    c->blocks[b->next].prev = b->prev;
+    if (c->lfu_buckets[count] == n) {
+        c->lfu_buckets[count] = b->next;
+    }
+}
+
+/*!
+  Поместить блок в голову кольцевого списка LFU
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param b Указатель на блок
+  \param count Текущее значение счетчика блока (номер списка)
+ */
+static inline void
+full_cache_lfu_push(FullCache *c, FullCacheBlock *b, int count)
+{
+    int n = b - c->blocks;
+    int head = c->lfu_buckets[count];
+    if (head == NO_INDEX) {
+        b->prev = b->next = n;
+    } else {
+        int tail = c->blocks[head].prev;
+        b->next = head;
+        b->prev = tail;
+        c->blocks[head].prev = n;
+        c->blocks[tail].next = n;
+    }
+    c->lfu_buckets[count] = n;
+    if (count < c->lfu_min) {
+        c->lfu_min = count;
     }
-    b->addr = aligned_addr;
-    c->mem->ops->read(c->mem, b->addr, c->block_size, b->mem);
+    if (count > c->lfu_max) {
+        c->lfu_max = count;
+    }
+}
+
+/*!
+  Соединить два кольцевых списка LFU
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param first Голова списка, блоки которого оказываются ближе к голове
+  \param second Голова списка, блоки которого оказываются ближе к хвосту
+  \return Голова объединенного списка
+ */
+static int
+full_cache_lfu_splice(FullCache *c, int first, int second)
+{
+    if (first == NO_INDEX) {
+        return second;
+    } else if (second == NO_INDEX) {
+        return first;
+    }
+    int first_tail = c->blocks[first].prev;
+    int second_tail = c->blocks[second].prev;
+    c->blocks[first_tail].next = second;
+    c->blocks[second].prev = first_tail;
+    c->blocks[second_tail].next = first;
+    c->blocks[first].prev = second_tail;
+    return first;
+}
+
+/*!
+  Учесть очередное обращение для старения LFU. По истечении интервала старения начинается
+  новая эпоха: списки сливаются по новым значениям счетчиков (списки с большими старыми
+  значениями - ближе к голове), а сами блоки не просматриваются, их счетчики пересчитываются
+  лениво при следующем обращении (см. lfu_count).
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+ */
+static inline void
+full_cache_lfu_tick(FullCache *c)
+{
+    if (++c->lfu_refs < c->lfu.aging_interval) {
+        return;
+    }
+    c->lfu_refs = 0;
+    c->lfu_epoch++;
+    int shift = c->lfu.aging_shift;
+    // список k переходит в список k >> shift, который к этому моменту уже опустошен:
+    for (int k = c->lfu_min; k <= c->lfu_max; k++) {
+        int head = c->lfu_buckets[k];
+        if (head != NO_INDEX) {
+            c->lfu_buckets[k] = NO_INDEX;
+            c->lfu_buckets[k >> shift] = full_cache_lfu_splice(c, head, c->lfu_buckets[k >> shift]);
+        }
+    }
+    c->lfu_min >>= shift;
+    c->lfu_max >>= shift;
+}
+
+/*!
+  Поместить блок ОЗУ в полноассоциативный кеш, вытесняя при необходимости
+  блок с наименьшим счетчиком LFU (из равных - хвост списка)
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Указатель на соответствующий блок кеша
+ */
+static FullCacheBlock *
+full_cache_lfu_place(FullCache *c, memaddr_t aligned_addr)
+{
+    full_cache_lfu_tick(c);
+    FullCacheBlock *b;
+    if (c->free_count) {
+        b = &c->blocks[c->free_blocks[--c->free_count]];
+    } else {
+        while (c->lfu_buckets[c->lfu_min] == NO_INDEX) {
+            c->lfu_min++;
+        }
+        b = &c->blocks[c->blocks[c->lfu_buckets[c->lfu_min]].prev];
+        full_cache_evict(c, b);
+        full_cache_lfu_unlink(c, b, c->lfu_min);
+    }
+    full_cache_fill(c, b, aligned_addr);
+    b->lfu_count = c->lfu.init_value;
+    b->lfu_epoch = c->lfu_epoch;
+    full_cache_lfu_push(c, b, b->lfu_count);
     return b;
 }
 
+/*!
+  Учет обращения к блоку при замещении LFU: счетчик увеличивается с насыщением,
+  блок переносится в голову соответствующего списка
+ */
+static void
+full_cache_lfu_touch(FullCache *c, FullCacheBlock *b)
+{
+    full_cache_lfu_tick(c);
+    int count = lfu_count(&c->lfu, b->lfu_count, b->lfu_epoch, c->lfu_epoch);
+    full_cache_lfu_unlink(c, b, count);
+    b->lfu_count = lfu_increment(&c->lfu, count);
+    b->lfu_epoch = c->lfu_epoch;
+    full_cache_lfu_push(c, b, b->lfu_count);
+}
+
+/*!
+  Найти блок полноассоциативного кеша, содержащий адрес, при промахе поместить блок в кеш
+  \param c Указатель на структуру описания модели полноассоциативного кеша
+  \param aligned_addr Адрес начала блока
+  \param p_hit Сюда записывается 1 в случае попадания и 0 в случае промаха
+  \return Указатель на блок кеша, содержащий адрес aligned_addr
+ */
+static inline FullCacheBlock *
+full_cache_fetch(FullCache *c, memaddr_t aligned_addr, int *p_hit)
+{
+    FullCacheBlock *b = full_cache_find(c, aligned_addr);
+    *p_hit = (b != NULL);
+    if (b) {
+        c->full_ops.touch(c, b);
+    } else {
+        b = c->full_ops.cache_place(c, aligned_addr);
+    }
+    return b;
+}
+
+/*!
+  Поместить прочитанное содержимое ячеек в блок кеша и "раскрыть" его в нижележащей памяти
+  (если кеш хранит данные)
+ */
+static inline void
+full_cache_reveal_block(FullCache *c, FullCacheBlock *b, memaddr_t addr, int size, MemoryCells src)
+{
+    if (c->data) {
+        memory_cells_copy(memory_cells_at(full_cache_cells(c, b), addr - *full_cache_tag(c, b)), src, size);
+        c->mem->ops->reveal(c->mem, addr, size, src);
+    }
+}
+
 /*!
   Прочитать ячейки из полноассоциативного кеша
   \param m Указатель на структуру описания модели полноассоциативного кеша (в виде указателя на базовую структуру)
@@ -153,23 +545,84 @@ full_cache_read(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    MemoryCell *dst)
+    MemoryCells dst)
 {
     FullCache *c = (FullCache*) m;
     memaddr_t aligned_addr = addr & -c->block_size;
-    statistics_add_counter(c->b.info, c->cache_read_time);
-    FullCacheBlock *b = full_cache_find(c, aligned_addr);
-    if (b) {
-        statistics_add_hit_counter(c->b.info);
-    } else {
-        b = c->full_ops.cache_place(c, aligned_addr);
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    FullCacheBlock *b = full_cache_fetch(c, aligned_addr, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
     }
-    if (dst) {
+    if (dst.value) {
 		// выполняем копирование данных:
-		memcpy(dst, b->mem + (addr - aligned_addr), size * sizeof(b->mem[0]));
+		memory_cells_copy(dst, memory_cells_at(full_cache_cells(c, b), addr - aligned_addr), size);
 	}
 }
 
+/*!
+  Прочитать ячейки из полноассоциативного кеша и "раскрыть" их содержимое
+  (то же, что read и reveal, но с одним поиском блока в кеше)
+  \param m Указатель на структуру описания модели полноассоциативного кеша (в виде указателя на базовую структуру)
+  \param addr Адрес в полноассоциативном кеше
+  \param size Количество считываемых ячеек
+  \param src Прочитанное содержимое ячеек
+ */
+static void
+full_cache_read_reveal(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells src)
+{
+    FullCache *c = (FullCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    FullCacheBlock *b = full_cache_fetch(c, addr & -c->block_size, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    full_cache_reveal_block(c, b, addr, size, src);
+}
+
+/*!
+  Выполнить пачку шагов чтения (см. read_batch), накапливая статистику в локальных переменных
+ */
+static void
+full_cache_read_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    FullCache *c = (FullCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        int hit;
+        FullCacheBlock *b = full_cache_fetch(c, steps[i].addr & -c->block_size, &hit);
+        hits += hit;
+        full_cache_reveal_block(c, b, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_reads(c->b.info, count, (long long) count * c->cache_read_time);
+    statistics_add_hit_counters(c->b.info, hits, (long long) hits * c->cache_read_time);
+}
+
+/*!
+  Записать ячейки в кеш со сквозной записью, не учитывая время записи в кеш
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline int
+full_cache_wt_store(FullCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    memaddr_t aligned_addr = addr & -c->block_size;
+    FullCacheBlock *b = full_cache_find(c, aligned_addr);
+    if (b) {
+        c->full_ops.touch(c, b);
+        if (c->data) {
+            memory_cells_copy(memory_cells_at(full_cache_cells(c, b), addr - aligned_addr), src, size);
+        }
+    }
+    full_cache_write_through(c, addr, size, src);
+    return b != NULL;
+}
+
 /*!
   Функция записи в кеш в случае сквозной записи
   \param m Указатель на структуру описания модели полноассоциативного кеша (в виде указателя на базовую структуру)
@@ -182,16 +635,50 @@ full_cache_wt_write(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    const MemoryCell *src)
+    MemoryCells src)
+{
+    FullCache *c = (FullCache*) m;
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (full_cache_wt_store(c, addr, size, src)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
+    }
+}
+
+/*!
+  Выполнить пачку шагов записи в кеш со сквозной записью (см. write_batch)
+ */
+static void
+full_cache_wt_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
 {
     FullCache *c = (FullCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += full_cache_wt_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
+}
+
+/*!
+  Записать ячейки в кеш с отложенной записью, не учитывая время записи в кеш
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline int
+full_cache_wb_store(FullCache *c, memaddr_t addr, int size, MemoryCells src)
+{
     memaddr_t aligned_addr = addr & -c->block_size;
     FullCacheBlock *b = full_cache_find(c, aligned_addr);
-    statistics_add_counter(c->b.info, c->cache_write_time);
+    int hit = (b != NULL);
     if (b) {
-        memcpy(b->mem + (addr - aligned_addr), src, size * sizeof(b->mem[0]));
+        c->full_ops.touch(c, b);
+    } else {
+        b = c->full_ops.cache_place(c, aligned_addr);
     }
-    c->mem->ops->write(c->mem, addr, size, src);
+    if (c->data) {
+        memory_cells_copy(memory_cells_at(full_cache_cells(c, b), addr - aligned_addr), src, size);
+    }
+    b->dirty = 1;
+    return hit;
 }
 
 /*!
@@ -206,17 +693,28 @@ full_cache_wb_write(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    const MemoryCell *src)
+    MemoryCells src)
 {
     FullCache *c = (FullCache*) m;
-    memaddr_t aligned_addr = addr & -c->block_size;
-    statistics_add_counter(c->b.info, c->cache_write_time);
-    FullCacheBlock *b = full_cache_find(c, aligned_addr);
-    if (!b) {
-        b = c->full_ops.cache_place(c, aligned_addr);
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (full_cache_wb_store(c, addr, size, src)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
     }
-    memcpy(b->mem + (addr - aligned_addr), src, size * sizeof(b->mem[0]));
-    b->dirty = 1;
+}
+
+/*!
+  Выполнить пачку шагов записи в кеш с отложенной записью (см. write_batch)
+ */
+static void
+full_cache_wb_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    FullCache *c = (FullCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += full_cache_wb_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
 }
 
 /*!
@@ -231,13 +729,13 @@ full_cache_reveal(
     AbstractMemory *m,
     memaddr_t addr,
     int size,
-    const MemoryCell *src)
+    MemoryCells src)
 {
     FullCache *c = (FullCache*) m;
     memaddr_t aligned_addr = addr & -c->block_size;
     FullCacheBlock *b = full_cache_find(c, aligned_addr);
-    if (b) {
-        memcpy(b->mem + (addr - aligned_addr), src, size * sizeof(b->mem[0]));
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(full_cache_cells(c, b), addr - aligned_addr), src, size);
     }
     c->mem->ops->reveal(c->mem, addr, size, src);
 }
@@ -258,8 +756,10 @@ static void
 full_cache_wb_finalize(FullCache *c, FullCacheBlock *b)
 {
     if (b->dirty) {
+        long long start = statistics_clock(c->b.info);
         statistics_add_write_back_counter(c->b.info);
-        c->mem->ops->write(c->mem, b->addr, c->block_size, b->mem);
+        c->mem->ops->write(c->mem, *full_cache_tag(c, b), c->block_size, full_cache_cells(c, b));
+        statistics_add_write_back_clock(c->b.info, statistics_clock(c->b.info) - start);
         b->dirty = 0;
     }
 }
@@ -274,7 +774,7 @@ full_cache_flush(AbstractMemory *m)
 {
     FullCache *c = (FullCache*) m;
     for (int i = 0; i < c->block_count; i++) {
-        if (c->blocks[i].addr != NO_BLOCK) {
+        if (c->tags[i] != NO_BLOCK) {
             c->full_ops.finalize(c, &c->blocks[i]);
         }
     }
@@ -299,6 +799,9 @@ static AbstractMemoryOps full_cache_wt_ops =
     full_cache_read,
     full_cache_wt_write,
     full_cache_reveal,
+    full_cache_read_reveal,
+    full_cache_read_batch,
+    full_cache_wt_write_batch,
     full_cache_flush,
     full_cache_print_dump
 };
@@ -309,6 +812,9 @@ static AbstractMemoryOps full_cache_wb_ops =
     full_cache_read,
     full_cache_wb_write,
     full_cache_reveal,
+    full_cache_read_reveal,
+    full_cache_read_batch,
+    full_cache_wb_write_batch,
     full_cache_flush,
     full_cache_print_dump
 };
@@ -333,7 +839,8 @@ full_cache_create(
     const char *var_prefix,
     StatisticsInfo *info,
     AbstractMemory *mem,
-    Random *rnd)
+    Random *rnd,
+    int tag_only)
 {
     char buf[PARAM_BUF_SIZE];
     FullCache *c = (FullCache*) calloc(1, sizeof(*c));
@@ -370,6 +877,21 @@ full_cache_create(
         goto full_cache_create_failed;
     } else if (strcmp(strategy, "random") == 0) {
         c->full_ops.cache_place = full_cache_random_place;
+        c->full_ops.touch = full_cache_random_touch;
+    } else if (strcmp(strategy, "lru") == 0) {
+        c->full_ops.cache_place = full_cache_lru_place;
+        c->full_ops.touch = full_cache_lru_touch;
+    } else if (strcmp(strategy, "lfu") == 0) {
+        c->full_ops.cache_place = full_cache_lfu_place;
+        c->full_ops.touch = full_cache_lfu_touch;
+        if (lfu_config_read(&c->lfu, cfg, var_prefix, fn) < 0) {
+            goto full_cache_create_failed;
+        }
+        c->lfu_buckets = malloc((c->lfu.max_count + 1) * sizeof(*c->lfu_buckets));
+        for (int i = 0; i <= c->lfu.max_count; i++) {
+            c->lfu_buckets[i] = NO_INDEX;
+        }
+        c->lfu_min = c->lfu.max_count;
     } else {
         error_invalid(fn, buf);
         goto full_cache_create_failed;
@@ -429,10 +951,33 @@ full_cache_create(
     
     //выделяем блоки кэша:
     c->block_count = c->cache_size / c->block_size;
+    if (!tag_only) {
+        c->data = memory_cells_arena_create(c->block_count, c->block_size);
+        // без области данных кеш не хранил бы значения и терял бы их по пути в ОЗУ:
+        if (!c->data) {
+            fprintf(stderr, "full_cache_create: out of memory\n");
+            goto full_cache_create_failed;
+        }
+    }
     c->blocks = calloc(c->block_count, sizeof(*c->blocks));
+    c->tags = calloc(c->block_count, sizeof(*c->tags));
+    c->free_blocks = calloc(c->block_count, sizeof(*c->free_blocks));
     for (int i = 0; i < c->block_count; i++) {
-        c->blocks[i].addr = NO_BLOCK;
-        c->blocks[i].mem = calloc(c->block_size, sizeof(c->blocks[i].mem[0]));
+        c->tags[i] = NO_BLOCK;
+        c->free_blocks[i] = c->block_count - 1 - i;
+    }
+    c->free_count = c->block_count;
+    c->lru_head = c->lru_tail = NO_INDEX;
+    // хеш-таблица заполнена не более чем наполовину:
+    int index_bits = 1;
+    while ((1 << index_bits) < 2 * c->block_count) {
+        index_bits++;
+    }
+    c->index_mask = (1 << index_bits) - 1;
+    c->index_shift = 64 - index_bits;
+    c->index = malloc((c->index_mask + 1) * sizeof(*c->index));
+    for (int i = 0; i <= c->index_mask; i++) {
+        c->index[i] = NO_INDEX;
     }
 
     return (AbstractMemory*) c;
@@ -20,9 +20,11 @@
   \param info Указатель на структуру, хранящую статистику моделирования
   \param mem Указатель на дескриптор нижележащей памяти (в виде указателя на базовую структуру)
   \param rnd Указатель на дескриптор генератора случайных чисел
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно: блоки кеша не хранят данные,
+  моделируются только теги и время доступа
   \return Указатель на структуру описания модели кеша (в виде указателя на базовую структуру)
  */
-AbstractMemory *full_cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd);
+AbstractMemory *full_cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd, int tag_only);
 
 #endif
 
@@ -0,0 +1,67 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "lfu.h"
+
+#include <limits.h>
+
+/*!
+  Ограничения значений параметров
+ */
+enum
+{
+    MAX_COUNT_SIZE = 16 //!< Максимальная разрядность счетчика
+};
+
+/*!
+  Считать целый параметр стратегии LFU и проверить, что он лежит в заданных пределах
+  \return 0 в случае успеха, -1 в случае ошибки
+ */
+static int
+lfu_param_read(
+    const ConfigFile *cfg,
+    const char *var_prefix,
+    const char *fn,
+    const char *name,
+    int min_value,
+    int max_value,
+    int *p_value)
+{
+    char buf[PARAM_BUF_SIZE];
+    int r = config_file_get_int(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, name), p_value);
+    if (!r) {
+        error_undefined(fn, buf);
+        return -1;
+    } else if (r < 0 || *p_value < min_value || *p_value > max_value) {
+        error_invalid(fn, buf);
+        return -1;
+    }
+    return 0;
+}
+
+int
+lfu_config_read(LfuConfig *lfu, const ConfigFile *cfg, const char *var_prefix, const char *fn)
+{
+    if (lfu_param_read(cfg, var_prefix, fn, "lfu_count_size",
+            1, MAX_COUNT_SIZE, &lfu->count_size) < 0)
+    {
+        return -1;
+    }
+    lfu->max_count = (1 << lfu->count_size) - 1;
+    if (lfu_param_read(cfg, var_prefix, fn, "lfu_init_value",
+            0, lfu->max_count, &lfu->init_value) < 0
+        || lfu_param_read(cfg, var_prefix, fn, "lfu_aging_interval",
+            1, INT_MAX, &lfu->aging_interval) < 0
+        || lfu_param_read(cfg, var_prefix, fn, "lfu_aging_shift",
+            1, lfu->count_size, &lfu->aging_shift) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
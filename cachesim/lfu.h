@@ -0,0 +1,80 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file lfu.h
+  \brief Параметры и вспомогательные функции стратегии замещения LFU со старением
+ */
+
+#ifndef LFU_H_INCLUDED
+#define LFU_H_INCLUDED
+
+#include "parse_config.h"
+
+/*!
+  Стратегия LFU хранит для каждого блока насыщающийся счетчик обращений разрядности lfu_count_size.
+  При загрузке блока счетчик равен lfu_init_value, при каждом попадании увеличивается на 1.
+  После каждых lfu_aging_interval обращений (попаданий и загрузок) начинается новая эпоха:
+  все счетчики сдвигаются вправо на lfu_aging_shift разрядов. Сдвиг применяется лениво:
+  блок хранит значение счетчика на момент эпохи последнего обращения к нему.
+  Вытесняется блок с наименьшим счетчиком. Из двух блоков с равными счетчиками вытесняется тот,
+  у которого счетчик был меньше в эпоху более позднего из последних обращений к ним,
+  а при равенстве и этих значений - дольше не использовавшийся.
+  \brief Параметры стратегии LFU
+ */
+typedef struct LfuConfig
+{
+    int count_size; //!< Разрядность счетчика (считывается из конф. файла)
+    int init_value; //!< Значение счетчика загруженного блока (считывается из конф. файла)
+    int aging_interval; //!< Число обращений между старениями (считывается из конф. файла)
+    int aging_shift; //!< Сдвиг счетчиков при старении (считывается из конф. файла)
+    int max_count; //!< Значение насыщения счетчика
+} LfuConfig;
+
+/*!
+  Считать и проверить параметры стратегии LFU
+  \param lfu Указатель на заполняемую структуру параметров
+  \param cfg Указатель на структуру, хранящую конфигурационные параметры
+  \param var_prefix Префикс имен параметров
+  \param fn Имя функции, от имени которой выводятся ошибки
+  \return 0 в случае успеха, -1 в случае ошибки
+ */
+int lfu_config_read(LfuConfig *lfu, const ConfigFile *cfg, const char *var_prefix, const char *fn);
+
+/*!
+  Вычислить значение счетчика в указанную эпоху
+  \param lfu Указатель на параметры стратегии LFU
+  \param count Значение счетчика в эпоху epoch
+  \param epoch Эпоха, в которой счетчик имел значение count
+  \param now Эпоха, для которой вычисляется значение (не меньше epoch)
+  \return Значение счетчика в эпоху now
+ */
+static inline int
+lfu_count(const LfuConfig *lfu, int count, unsigned long long epoch, unsigned long long now)
+{
+    // после count_size эпох счетчик гарантированно обнулен, это же защищает от переполнения:
+    if (now - epoch >= (unsigned) lfu->count_size) {
+        return 0;
+    }
+    int shift = (int) (now - epoch) * lfu->aging_shift;
+    return (shift < lfu->count_size) ? count >> shift : 0;
+}
+
+/*!
+  Увеличить счетчик на 1 с насыщением
+  \param lfu Указатель на параметры стратегии LFU
+  \param count Значение счетчика
+  \return Новое значение счетчика
+ */
+static inline int
+lfu_increment(const LfuConfig *lfu, int count)
+{
+    return (count < lfu->max_count) ? count + 1 : count;
+}
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -2,19 +2,49 @@
 
 #include "memory.h"
 
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /*!
   Ограничения значений параметров
  */
 enum
 {
-    MAX_MEM_SIZE = 1 * GiB, //!< Максимальный поддерживаемый размер ОЗУ модели
     MAX_READ_TIME = 100000, //!< Максимальное время чтения из ОЗУ в тактах
     MAX_WRITE_TIME = MAX_READ_TIME, //!< Максимальное время записи в озу в тактах
     MAX_WIDTH = 1024 //!< Максимальный размер блока памяти
 };
 
+/*!
+  Параметры страничной организации ОЗУ модели. Страницы выделяются при первой
+  записи или "раскрытии" ячеек; нетронутые страницы состоят из неизвестных ячеек.
+  Таблица страниц - хеш-таблица по номеру страницы, так что расход памяти зависит
+  только от числа тронутых страниц, а не от размера адресного пространства.
+ */
+enum
+{
+    PAGE_SHIFT = 12, //!< Логарифм размера страницы
+    PAGE_SIZE = 1 << PAGE_SHIFT, //!< Размер страницы в ячейках (4 KiB)
+    PAGE_MASK = PAGE_SIZE - 1, //!< Маска смещения внутри страницы
+    INITIAL_PAGE_TABLE_SIZE = 64, //!< Начальный размер таблицы страниц (степень двойки)
+    IMAGE_RECORD_SIZE = 8 + PAGE_SIZE + PAGE_SIZE / 8 //!< Размер записи страницы в двоичном образе ОЗУ
+};
+
+/*!
+  Элемент таблицы страниц
+ */
+typedef struct MemoryPage
+{
+    memaddr_t number; //!< Номер страницы (адрес ее начала, сдвинутый на PAGE_SHIFT)
+    unsigned char *cells; //!< Буфер ячеек страницы, NULL - элемент таблицы свободен
+} MemoryPage;
+
 struct Memory;
 typedef struct Memory Memory;
 
@@ -25,13 +55,34 @@ typedef struct Memory Memory;
 struct Memory
 {
     AbstractMemory b; //!< Базовые поля
-    MemoryCell *mem; //!< Массив ячеек памяти
-    int memory_size; //!< Размер ОЗУ (считанный из конфиг. файла)
+    MemoryPage *pages; //!< Таблица страниц (хеш-таблица с открытой адресацией)
+    int page_mask; //!< Размер таблицы страниц минус 1
+    int page_count; //!< Количество выделенных страниц
+    unsigned char *image; //!< Отображенный в память файл начального образа ОЗУ, NULL - образ не загружался
+    size_t image_size; //!< Размер отображенного файла образа
+    memaddr_t memory_size; //!< Размер ОЗУ (считанный из конфиг. файла)
     int memory_read_time; //!< Время чтения из ОЗУ
     int memory_write_time; //!< Время записи в ОЗУ
     int memory_width; //!< Полоса пропускания ОЗУ
+    int tag_only; //!< Ненулевое значение, если содержимое ОЗУ не хранится
+    int failed; //!< Ненулевое значение, если модели не хватило памяти (см. memory_failed)
 };
 
+/*!
+  Зафиксировать нехватку памяти: сообщение печатается один раз, модель продолжает работу
+  без сохранения новых ячеек, а ошибку получает вызывающий через memory_failed
+  \param m Указатель на структуру описания модели ОЗУ
+  \param func Имя функции, в которой не удалось выделить память
+ */
+static void
+memory_out_of_memory(Memory *m, const char *func)
+{
+    if (!m->failed) {
+        fprintf(stderr, "%s: out of memory\n", func);
+        m->failed = 1;
+    }
+}
+
 /*!
   Освободить ресурсы
   \param a Указатель на структуру описания модели ОЗУ (в виде указателя на базовую структуру)
@@ -42,12 +93,159 @@ memory_free(AbstractMemory *a)
 {
     if (a) {
         Memory *m = (Memory *)a;
-        free(m->mem);
+        if (m->pages) {
+            for (int i = 0; i <= m->page_mask; ++i) {
+                // страницы образа находятся в отображенном файле и не освобождаются по отдельности
+                unsigned char *cells = m->pages[i].cells;
+                if (!m->image || cells < m->image || cells >= m->image + m->image_size) {
+                    free(cells);
+                }
+            }
+            free(m->pages);
+        }
+        if (m->image) {
+            munmap(m->image, m->image_size);
+        }
         free(m);
     }
     return NULL;
 }
 
+/*!
+  Найти элемент таблицы страниц (мультипликативное хеширование, линейное пробирование)
+  \param m Указатель на структуру описания модели ОЗУ
+  \param number Номер страницы
+  \return Указатель на элемент таблицы: либо описывающий страницу, либо свободный
+ */
+static inline MemoryPage *
+memory_page_slot(const Memory *m, memaddr_t number)
+{
+    int i = (int) ((number * 0x9E3779B97F4A7C15ULL) >> 32) & m->page_mask;
+    while (m->pages[i].cells && m->pages[i].number != number) {
+        i = (i + 1) & m->page_mask;
+    }
+    return &m->pages[i];
+}
+
+/*!
+  Получить буфер ячеек страницы, содержащей адрес
+  \param m Указатель на структуру описания модели ОЗУ
+  \param addr Адрес в ОЗУ
+  \return Буфер ячеек страницы, NULL - страница не выделялась
+ */
+static inline unsigned char *
+memory_find_page(const Memory *m, memaddr_t addr)
+{
+    return memory_page_slot(m, addr >> PAGE_SHIFT)->cells;
+}
+
+/*!
+  Удвоить размер таблицы страниц
+  \param m Указатель на структуру описания модели ОЗУ
+  \return 0 в случае успеха, -1 при нехватке памяти (таблица остается прежней)
+ */
+static int
+memory_grow_pages(Memory *m)
+{
+    MemoryPage *pages = m->pages;
+    int size = m->page_mask + 1;
+    m->pages = calloc(2 * size, sizeof(m->pages[0]));
+    if (!m->pages) {
+        m->pages = pages;
+        memory_out_of_memory(m, "memory_grow_pages");
+        return -1;
+    }
+    m->page_mask = 2 * size - 1;
+    for (int i = 0; i < size; i++) {
+        if (pages[i].cells) {
+            *memory_page_slot(m, pages[i].number) = pages[i];
+        }
+    }
+    free(pages);
+    return 0;
+}
+
+/*!
+  Занести страницу в свободный элемент таблицы страниц, увеличивая таблицу при необходимости
+  \param m Указатель на структуру описания модели ОЗУ
+  \param p Свободный элемент таблицы, найденный функцией memory_page_slot
+  \param number Номер страницы
+  \param cells Буфер ячеек страницы
+  \return Указатель на элемент таблицы, описывающий страницу, NULL при нехватке памяти
+ */
+static MemoryPage *
+memory_add_page(Memory *m, MemoryPage *p, memaddr_t number, unsigned char *cells)
+{
+    if (2 * (m->page_count + 1) > m->page_mask + 1) {
+        if (memory_grow_pages(m) < 0) {
+            return NULL;
+        }
+        p = memory_page_slot(m, number);
+    }
+    p->number = number;
+    p->cells = cells;
+    m->page_count++;
+    return p;
+}
+
+/*!
+  Получить ячейки страницы, содержащей адрес, начиная с этого адреса,
+  выделяя страницу при необходимости
+  \param m Указатель на структуру описания модели ОЗУ
+  \param addr Адрес в ОЗУ (меньше размера ОЗУ)
+  \return Ячейки страницы, начиная с адреса addr (с value, равным NULL, при нехватке памяти)
+ */
+static MemoryCells
+memory_touch_page(Memory *m, memaddr_t addr)
+{
+    MemoryPage *p = memory_page_slot(m, addr >> PAGE_SHIFT);
+    if (!p->cells) {
+        // после нехватки памяти новые страницы не выделяются, их ячейки остаются неизвестными:
+        unsigned char *cells = m->failed ? NULL : calloc(1, memory_cells_buf_size(PAGE_SIZE));
+        if (cells && !(p = memory_add_page(m, p, addr >> PAGE_SHIFT, cells))) {
+            free(cells);
+            cells = NULL;
+        }
+        if (!cells) {
+            memory_out_of_memory(m, "memory_touch_page");
+            return (MemoryCells) { NULL, NULL, 0 };
+        }
+    }
+    return memory_cells_at(memory_cells_make(p->cells, PAGE_SIZE), addr & PAGE_MASK);
+}
+
+/*!
+  Скопировать ячейки в ОЗУ постранично (общая часть записи и "раскрытия")
+  \param m Указатель на структуру описания модели ОЗУ
+  \param addr Адрес в ОЗУ
+  \param size Количество копируемых ячеек
+  \param src Ячейки, откуда копировать
+ */
+static void
+memory_store(Memory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    if (m->tag_only || !src.value || addr >= m->memory_size) {
+        return;
+    }
+    if (size > m->memory_size - addr) {
+        size = m->memory_size - addr;
+    }
+    while (size > 0) {
+        int off = addr & PAGE_MASK;
+        int n = PAGE_SIZE - off;
+        if (n > size) {
+            n = size;
+        }
+        MemoryCells dst = memory_touch_page(m, addr);
+        if (dst.value) {
+            memory_cells_copy(dst, src, n);
+        }
+        addr += n;
+        src = memory_cells_at(src, n);
+        size -= n;
+    }
+}
+
 /*!
   Прочитать ячейки из ОЗУ
   \param a Указатель на структуру описания модели ОЗУ (в виде указателя на базовую структуру)
@@ -60,22 +258,37 @@ memory_read(
 	AbstractMemory *a,
 	memaddr_t addr,
 	int size,
-	MemoryCell *dst)
+	MemoryCells dst)
 {
     Memory *m = (Memory *) a;
     // учитываем время, требуемое на выполнение операции чтения:
     int blocks_count = (size + m->memory_width - 1) / m->memory_width;
     //количество блоков округлено вверх
-    statistics_add_counter(m->b.info, blocks_count * m->memory_read_time);
-    if (dst) {
-		// выполняем копирование данных:
-		for (; size; ++addr, --size, ++dst) {
-			if (addr >= m->memory_size) {
-				break;
-			}
-			*dst = m->mem[addr];
-		}
-	}
+    statistics_add_cache_read(m->b.info, blocks_count * m->memory_read_time);
+    if (!dst.value || addr >= m->memory_size) {
+        return;
+    }
+    if (size > m->memory_size - addr) {
+        size = m->memory_size - addr;
+    }
+    // выполняем копирование данных, невыделенные страницы читаются как неизвестные:
+    while (size > 0) {
+        int off = addr & PAGE_MASK;
+        int n = PAGE_SIZE - off;
+        if (n > size) {
+            n = size;
+        }
+        unsigned char *page = memory_find_page(m, addr);
+        if (page) {
+            memory_cells_copy(dst,
+                memory_cells_at(memory_cells_make(page, PAGE_SIZE), off), n);
+        } else {
+            memory_cells_forget(dst, n);
+        }
+        addr += n;
+        dst = memory_cells_at(dst, n);
+        size -= n;
+    }
 }
 
 /*!
@@ -90,21 +303,15 @@ memory_write(
 	AbstractMemory *a,
 	memaddr_t addr,
 	int size,
-	const MemoryCell *src)
+	MemoryCells src)
 {
     Memory *m = (Memory *) a;
     // учитываем время, требуемое на выполнение операции записи:
     int blocks_count = (size + m->memory_width - 1) / m->memory_width;
     //количество блоков округлено вверх
-    statistics_add_counter(m->b.info, blocks_count * m->memory_write_time);
+    statistics_add_cache_write(m->b.info, blocks_count * m->memory_write_time);
     // выполняем копирование данных:
-    for (; size; ++addr, --size, ++src) {
-		if (addr >= m->memory_size) {
-			break;
-		}
-        m->mem[addr] = *src;
-    }
-
+    memory_store(m, addr, size, src);
 }
 
 /*!
@@ -119,16 +326,59 @@ memory_reveal(
 	AbstractMemory *a,
 	memaddr_t addr,
 	int size,
-	const MemoryCell *src)
+	MemoryCells src)
+{
+    memory_store((Memory *) a, addr, size, src);
+}
+
+/*!
+  Прочитать ячейки из ОЗУ и "раскрыть" их содержимое (то же, что read и reveal)
+  \param a Указатель на структуру описания модели ОЗУ (в виде указателя на базовую структуру)
+  \param addr Адрес в ОЗУ
+  \param size Количество считываемых ячеек
+  \param src Прочитанное содержимое ячеек
+ */
+static void
+memory_read_reveal(
+	AbstractMemory *a,
+	memaddr_t addr,
+	int size,
+	MemoryCells src)
+{
+    Memory *m = (Memory *) a;
+    int blocks_count = (size + m->memory_width - 1) / m->memory_width;
+    statistics_add_cache_read(m->b.info, blocks_count * m->memory_read_time);
+    memory_store(m, addr, size, src);
+}
+
+/*!
+  Выполнить пачку шагов чтения из ОЗУ (см. read_batch)
+ */
+static void
+memory_read_batch(AbstractMemory *a, const TraceStep *steps, int count)
 {
     Memory *m = (Memory *) a;
+    long long clock_counter = 0;
+    for (int i = 0; i < count; i++) {
+        clock_counter += (steps[i].size + m->memory_width - 1) / m->memory_width * m->memory_read_time;
+        memory_store(m, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_reads(m->b.info, count, clock_counter);
+}
 
-    for (; size; ++addr, --size, ++src) {
-        if (addr >= m->memory_size) {
-			break;
-		}
-        m->mem[addr] = *src;
+/*!
+  Выполнить пачку шагов записи в ОЗУ (см. write_batch)
+ */
+static void
+memory_write_batch(AbstractMemory *a, const TraceStep *steps, int count)
+{
+    Memory *m = (Memory *) a;
+    long long clock_counter = 0;
+    for (int i = 0; i < count; i++) {
+        clock_counter += (steps[i].size + m->memory_width - 1) / m->memory_width * m->memory_write_time;
+        memory_store(m, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
     }
+    statistics_add_cache_writes(m->b.info, count, clock_counter);
 }
 
 /*!
@@ -141,13 +391,164 @@ memory_flush(AbstractMemory *m)
 	return;
 }
 
+/*!
+  Функция сравнения номеров страниц для qsort
+ */
+static int
+memory_page_number_compare(const void *p1, const void *p2)
+{
+    memaddr_t n1 = *(const memaddr_t *) p1, n2 = *(const memaddr_t *) p2;
+    return (n1 > n2) - (n1 < n2);
+}
+
+/*!
+  Проверить, есть ли на странице известные ячейки
+  \param cells Буфер ячеек страницы
+  \return Ненулевое значение, если значение хотя бы одной ячейки известно
+ */
+static int
+memory_page_known(const unsigned char *cells)
+{
+    const unsigned char *known = memory_cells_make((unsigned char *) cells, PAGE_SIZE).known;
+    for (int i = 0; i < PAGE_SIZE / 8; i++) {
+        if (known[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*!
+  Получить номера страниц ОЗУ в порядке возрастания
+  \param m Указатель на структуру описания модели ОЗУ
+  \param known_only Ненулевое значение, если нужны только страницы с известными ячейками
+  \param p_count Сюда записывается число страниц
+  \return Массив номеров страниц (освобождается функцией free), NULL при нехватке памяти
+ */
+static memaddr_t *
+memory_sorted_pages(Memory *m, int known_only, int *p_count)
+{
+    memaddr_t *numbers = malloc((m->page_count + 1) * sizeof(*numbers));
+    if (!numbers) {
+        memory_out_of_memory(m, "memory_sorted_pages");
+        return NULL;
+    }
+    int count = 0;
+    for (int i = 0; i <= m->page_mask; i++) {
+        if (m->pages[i].cells && (!known_only || memory_page_known(m->pages[i].cells))) {
+            numbers[count++] = m->pages[i].number;
+        }
+    }
+    qsort(numbers, count, sizeof(*numbers), memory_page_number_compare);
+    *p_count = count;
+    return numbers;
+}
+
 enum DUMP_PARAMS
 {
-	COLS_COUNT = 16
+	COLS_COUNT = 16,
+	DUMP_ROW_MAX = 16 + 3 * COLS_COUNT + 1, //!< Наибольшая длина строки дампа (адрес - до 16 цифр)
+	DUMP_CHUNK_SIZE = 1 * MiB, //!< Размер диапазона адресов, форматируемого в один буфер
+	DUMP_CHUNK_ROWS = DUMP_CHUNK_SIZE / COLS_COUNT, //!< Число строк дампа в одном буфере
+	DUMP_PARALLEL_SIZE = 16 * MiB, //!< Наименьший размер ОЗУ, дамп которого форматируется несколькими потоками
+	DUMP_MAX_THREADS = 8 //!< Наибольшее число потоков, форматирующих дамп
 };
 
+//! Строка дампа из COLS_COUNT неизвестных ячеек
+static const char UNKNOWN_ROW[] = " ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ??";
+
+//! Таблица шестнадцатеричных цифр
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/*!
+  Диапазон адресов ОЗУ, форматируемый в текст дампа одним потоком
+  \brief Порция дампа
+ */
+typedef struct DumpChunk
+{
+    pthread_t thread; //!< Идентификатор потока, форматирующего порцию
+    int threaded; //!< 1 - порцию форматирует поток thread, 0 - вызвавший поток
+    const Memory *m; //!< Модель ОЗУ
+    memaddr_t begin; //!< Адрес начала диапазона (кратен COLS_COUNT)
+    memaddr_t end; //!< Адрес конца диапазона
+    char *buf; //!< Буфер текста размером DUMP_CHUNK_ROWS * DUMP_ROW_MAX
+    size_t size; //!< Длина сформированного текста
+} DumpChunk;
+
 /*!
-    Печатает содержимое памяти.
+  Сформировать адрес так же, как это сделал бы printf("%08llX", addr)
+  \param p Куда записывать адрес (не менее 16 символов)
+  \param addr Адрес
+  \return Указатель на символ, следующий за адресом
+ */
+static inline char *
+memory_format_addr(char *p, memaddr_t addr)
+{
+    int digits = 8;
+    while (digits < 16 && (addr >> (4 * digits))) {
+        digits++;
+    }
+    for (int i = digits - 1; i >= 0; i--) {
+        *p++ = HEX_DIGITS[(addr >> (4 * i)) & 0xF];
+    }
+    return p;
+}
+
+/*!
+  Сформировать строку дампа так же, как это сделала бы последовательность
+  printf("%08llX", addr) и printf(" %02X") или printf(" ??") для каждой ячейки
+  \param p Куда записывать строку (не менее DUMP_ROW_MAX символов)
+  \param addr Адрес начала строки
+  \param page Буфер ячеек страницы, содержащей строку, NULL - страница не выделялась
+  \return Указатель на символ, следующий за концом строки
+ */
+static char *
+memory_format_row(char *p, memaddr_t addr, const unsigned char *page)
+{
+    p = memory_format_addr(p, addr);
+    if (!page) {
+        // страница не выделялась, все ее ячейки неизвестны
+        memcpy(p, UNKNOWN_ROW, sizeof(UNKNOWN_ROW) - 1);
+        p += sizeof(UNKNOWN_ROW) - 1;
+    } else {
+        MemoryCells row = memory_cells_at(memory_cells_make((unsigned char *) page, PAGE_SIZE), addr & PAGE_MASK);
+        for (int off = 0; off < COLS_COUNT; off++, p += 3) {
+            p[0] = ' ';
+            if (memory_cells_known(row, off)) {
+                p[1] = HEX_DIGITS[row.value[off] >> 4];
+                p[2] = HEX_DIGITS[row.value[off] & 0xF];
+            } else {
+                p[1] = p[2] = '?';
+            }
+        }
+    }
+    *p++ = '\n';
+    return p;
+}
+
+/*!
+  Функция потока: сформировать текст дампа порции
+ */
+static void *
+memory_format_chunk(void *arg)
+{
+    DumpChunk *d = arg;
+    char *p = d->buf;
+    const unsigned char *page = NULL;
+    for (memaddr_t addr = d->begin; addr < d->end; addr += COLS_COUNT) {
+        if (addr == d->begin || !(addr & PAGE_MASK)) {
+            page = memory_find_page(d->m, addr);
+        }
+        p = memory_format_row(p, addr, page);
+    }
+    d->size = p - d->buf;
+    return NULL;
+}
+
+/*!
+    Печатает содержимое памяти. Строки формируются в буферах порциями по DUMP_CHUNK_SIZE
+    адресов и выводятся функцией fwrite; дамп большого ОЗУ форматируется несколькими потоками,
+    каждый из которых формирует свою порцию.
     \param m Указатель на структуру описания модели памяти
     \param out_f Файл, куда печатается содержимое памяти
 */
@@ -155,17 +556,142 @@ void
 memory_print_dump(AbstractMemory *a, FILE *f_out)
 {
 	Memory *m = (Memory *) a;
-	for (int addr = 0; addr < m->memory_size; addr += COLS_COUNT) {
-        printf("%08X", addr);
-        for (int off = 0; off < COLS_COUNT; off++) {
-            if (m->mem[addr + off].flags) {
-				fprintf(f_out, " %02X", m->mem[addr + off].value);
-			} else {
-				fprintf(f_out, " ??");
-			}
+    int threads = 1;
+    if (m->memory_size >= DUMP_PARALLEL_SIZE) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (n < 1) ? 1 : (n > DUMP_MAX_THREADS) ? DUMP_MAX_THREADS : n;
+    }
+    DumpChunk chunks[DUMP_MAX_THREADS];
+    for (int i = 0; i < threads; i++) {
+        chunks[i].m = m;
+        chunks[i].buf = malloc(DUMP_CHUNK_ROWS * DUMP_ROW_MAX);
+        if (!chunks[i].buf) {
+            // дамп не печатается, ошибку получает вызывающий через memory_failed:
+            memory_out_of_memory(m, "memory_print_dump");
+            while (i-- > 0) {
+                free(chunks[i].buf);
+            }
+            return;
+        }
+    }
+    memaddr_t addr = 0;
+    while (addr < m->memory_size) {
+        int n = 0;
+        for (; n < threads && addr < m->memory_size; n++) {
+            chunks[n].begin = addr;
+            addr += (m->memory_size - addr < DUMP_CHUNK_SIZE) ? m->memory_size - addr : DUMP_CHUNK_SIZE;
+            chunks[n].end = addr;
+        }
+        // первую порцию, а также порции, для которых не удалось создать поток,
+        // форматирует сам вызвавший поток:
+        for (int i = 1; i < n; i++) {
+            chunks[i].threaded = !pthread_create(&chunks[i].thread, NULL, memory_format_chunk, &chunks[i]);
+        }
+        for (int i = 0; i < n; i++) {
+            if (!i || !chunks[i].threaded) {
+                memory_format_chunk(&chunks[i]);
+            }
+        }
+        for (int i = 1; i < n; i++) {
+            if (chunks[i].threaded) {
+                pthread_join(chunks[i].thread, NULL);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            fwrite(chunks[i].buf, 1, chunks[i].size, f_out);
+        }
+    }
+    for (int i = 0; i < threads; i++) {
+        free(chunks[i].buf);
+    }
+}
+
+
+/*!
+  Состояние вывода сжатого дампа
+  \brief Сжатый дамп
+ */
+typedef struct CompactDump
+{
+    FILE *f_out; //!< Файл, куда печатается дамп
+    char *buf; //!< Буфер вывода размером DUMP_CHUNK_ROWS * DUMP_ROW_MAX
+    size_t size; //!< Длина текста в буфере
+    char last[3 * COLS_COUNT]; //!< Ячейки последней напечатанной строки
+    int has_last; //!< Напечатана ли хотя бы одна строка
+    int starred; //!< Напечатана ли после последней строки строка "*"
+} CompactDump;
+
+/*!
+  Вывести строку сжатого дампа: строка, совпадающая по содержимому с предыдущей,
+  заменяется строкой "*" (одной на всю серию совпадающих строк)
+  \param d Указатель на состояние вывода
+  \param addr Адрес начала строки
+  \param page Буфер ячеек страницы, содержащей строку, NULL - страница не выделялась
+ */
+static void
+memory_compact_row(CompactDump *d, memaddr_t addr, const unsigned char *page)
+{
+    if (d->size > DUMP_CHUNK_ROWS * DUMP_ROW_MAX - DUMP_ROW_MAX) {
+        fwrite(d->buf, 1, d->size, d->f_out);
+        d->size = 0;
+    }
+    char *row = d->buf + d->size;
+    char *end = memory_format_row(row, addr, page);
+    char *cells = end - 1 - sizeof(d->last);
+    if (d->has_last && !memcmp(cells, d->last, sizeof(d->last))) {
+        if (!d->starred) {
+            memcpy(row, "*\n", 2);
+            d->size += 2;
+            d->starred = 1;
         }
-        printf("\n");
+        return;
     }
+    memcpy(d->last, cells, sizeof(d->last));
+    d->has_last = 1;
+    d->starred = 0;
+    d->size += end - row;
+}
+
+void
+memory_print_compact_dump(AbstractMemory *a, FILE *f_out)
+{
+    Memory *m = (Memory *) a;
+    CompactDump d = { .f_out = f_out };
+    int count;
+    d.buf = malloc(DUMP_CHUNK_ROWS * DUMP_ROW_MAX);
+    memaddr_t *numbers = d.buf ? memory_sorted_pages(m, 0, &count) : NULL;
+    if (!numbers) {
+        // дамп не печатается, ошибку получает вызывающий через memory_failed:
+        memory_out_of_memory(m, "memory_print_compact_dump");
+        free(d.buf);
+        return;
+    }
+    memaddr_t addr = 0;
+    for (int i = 0; i <= count; i++) {
+        memaddr_t next = (i < count) ? numbers[i] << PAGE_SHIFT : m->memory_size;
+        if (next > addr) {
+            // невыделенные страницы: все строки неизвестны, достаточно двух первых
+            memory_compact_row(&d, addr, NULL);
+            if (next - addr > COLS_COUNT) {
+                memory_compact_row(&d, addr + COLS_COUNT, NULL);
+            }
+        }
+        if (i == count) {
+            break;
+        }
+        const unsigned char *page = memory_find_page(m, next);
+        addr = (m->memory_size - next > PAGE_SIZE) ? next + PAGE_SIZE : m->memory_size;
+        for (memaddr_t row = next; row < addr; row += COLS_COUNT) {
+            memory_compact_row(&d, row, page);
+        }
+    }
+    // последняя строка - размер ОЗУ (конец последней серии):
+    fwrite(d.buf, 1, d.size, f_out);
+    char *end = memory_format_addr(d.buf, m->memory_size);
+    *end++ = '\n';
+    fwrite(d.buf, 1, end - d.buf, f_out);
+    free(numbers);
+    free(d.buf);
 }
 
 
@@ -175,10 +701,135 @@ static AbstractMemoryOps memory_ops =
     memory_read,
     memory_write,
     memory_reveal,
+    memory_read_reveal,
+    memory_read_batch,
+    memory_write_batch,
     memory_flush,
     memory_print_dump
 };
 
+int
+memory_write_image(AbstractMemory *a, const char *path, FILE *log_f)
+{
+    Memory *m = (Memory *) a;
+    // в образ попадают только страницы с известными ячейками, по возрастанию номеров:
+    int count;
+    memaddr_t *numbers = memory_sorted_pages(m, 1, &count);
+    if (!numbers) {
+        return -1;
+    }
+
+    // образ пишется во временный файл и затем переименовывается: файл, загруженный
+    // memory_load_image, может совпадать с path, и его нельзя обрезать, пока он отображен в память
+    char *tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+    if (!tmp_path) {
+        memory_out_of_memory(m, "memory_write_image");
+        free(numbers);
+        return -1;
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+    FILE *out_f = fopen(tmp_path, "wb");
+    if (!out_f) {
+        fprintf(log_f, "Failed to open %s for writing\n", tmp_path);
+        free(tmp_path);
+        free(numbers);
+        return -1;
+    }
+    unsigned char rec[IMAGE_RECORD_SIZE];
+    memcpy(rec, MEMORY_IMAGE_MAGIC, sizeof(MEMORY_IMAGE_MAGIC) - 1);
+    put_le32(rec + 8, MEMORY_IMAGE_VERSION);
+    put_le32(rec + 12, PAGE_SIZE);
+    put_le64(rec + 16, m->memory_size);
+    put_le64(rec + 24, count);
+    int ok = fwrite(rec, MEMORY_IMAGE_HEADER_SIZE, 1, out_f) == 1;
+    for (int i = 0; ok && i < count; i++) {
+        MemoryCells page = memory_cells_make(memory_find_page(m, numbers[i] << PAGE_SHIFT), PAGE_SIZE);
+        put_le64(rec, numbers[i]);
+        // значения неизвестных ячеек не определены, в образ они записываются нулями:
+        for (int j = 0; j < PAGE_SIZE; j++) {
+            rec[8 + j] = memory_cells_known(page, j) ? page.value[j] : 0;
+        }
+        memcpy(rec + 8 + PAGE_SIZE, page.known, PAGE_SIZE / 8);
+        ok = fwrite(rec, sizeof(rec), 1, out_f) == 1;
+    }
+    if (fclose(out_f) != 0) {
+        ok = 0;
+    }
+    if (ok && rename(tmp_path, path) != 0) {
+        ok = 0;
+    }
+    free(numbers);
+    if (!ok) {
+        fprintf(log_f, "Failed to write %s\n", path);
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    free(tmp_path);
+    return 0;
+}
+
+int
+memory_load_image(AbstractMemory *a, const char *path, FILE *log_f)
+{
+    Memory *m = (Memory *) a;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(log_f, "Failed to open %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (m->image) {
+        fprintf(log_f, "%s: memory image is already loaded\n", path);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size < MEMORY_IMAGE_HEADER_SIZE) {
+        close(fd);
+        goto memory_load_image_invalid;
+    }
+    // страницы образа изменяются моделью, но не записываются в файл:
+    unsigned char *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(log_f, "Failed to map %s\n", path);
+        return -1;
+    }
+    m->image = map;
+    m->image_size = st.st_size;
+    unsigned long long count = get_le64(map + 24);
+    if (memcmp(map, MEMORY_IMAGE_MAGIC, sizeof(MEMORY_IMAGE_MAGIC) - 1)
+        || get_le32(map + 8) != MEMORY_IMAGE_VERSION
+        || get_le32(map + 12) != PAGE_SIZE
+        || (m->image_size - MEMORY_IMAGE_HEADER_SIZE) % IMAGE_RECORD_SIZE
+        || (m->image_size - MEMORY_IMAGE_HEADER_SIZE) / IMAGE_RECORD_SIZE != count)
+    {
+        goto memory_load_image_invalid;
+    }
+    memaddr_t page_limit = (m->memory_size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    unsigned char *rec = map + MEMORY_IMAGE_HEADER_SIZE;
+    for (unsigned long long i = 0; i < count; i++, rec += IMAGE_RECORD_SIZE) {
+        memaddr_t number = get_le64(rec);
+        MemoryPage *p = memory_page_slot(m, number);
+        // номера страниц возрастают, страницы должны помещаться в ОЗУ и еще не использоваться:
+        if ((i && number <= get_le64(rec - IMAGE_RECORD_SIZE)) || number >= page_limit || p->cells) {
+            goto memory_load_image_invalid;
+        }
+        if (!memory_add_page(m, p, number, rec + 8)) {
+            return -1;
+        }
+    }
+    return 0;
+
+memory_load_image_invalid:
+    fprintf(log_f, "%s: invalid memory image\n", path);
+    return -1;
+}
+
 /*!
   Создать модель ОЗУ
   \param cfg Указатель на структуру, хранящую конфигурационные параметры
@@ -191,9 +842,11 @@ AbstractMemory *
 memory_create(
 	const ConfigFile *cfg,
 	const char *var_prefix,
-	StatisticsInfo *info)
+	StatisticsInfo *info,
+	int tag_only)
 {
     Memory *m = calloc(1, sizeof(*m));
+    m->tag_only = tag_only;
 
     // заполняем базовые поля:
     m->b.ops = &memory_ops;
@@ -201,19 +854,19 @@ memory_create(
 
 	const char fn[] = "memory_create";
 	char buf[PARAM_BUF_SIZE];
-    // считываем и проверяем параметр memory_size:
-    int r = config_file_get_int(cfg,
+    // считываем и проверяем параметр memory_size (адресное пространство может быть 64-битным):
+    long long memory_size;
+    int r = config_file_get_llong(cfg,
 		make_param_name(buf, sizeof(buf), var_prefix, "memory_size"),
-		&m->memory_size);
+		&memory_size);
 	if (!r) {
 		error_undefined(fn, buf);
 		goto memory_create_failed;
-	} else if (r < 0 || m->memory_size <= 0
-        || m->memory_size > MAX_MEM_SIZE
-        || m->memory_size % KiB != 0) {
+	} else if (r < 0 || memory_size <= 0 || memory_size % KiB != 0) {
 		error_invalid(fn, buf);
 		goto memory_create_failed;
 	}
+    m->memory_size = memory_size;
 	// считываем и проверяем параметр memory_read_time:
     r = config_file_get_int(cfg,
 		make_param_name(buf, sizeof(buf), var_prefix, "memory_read_time"),
@@ -244,14 +897,15 @@ memory_create(
 	if (!r) {
 		error_undefined(fn, buf);
 		goto memory_create_failed;
-	} else if (r < 0 || m->memory_width <= 0 || m->memory_width > MAX_MEM_SIZE) {
+	} else if (r < 0 || m->memory_width <= 0 || m->memory_width > GiB) {
 		error_invalid(fn, buf);
 		goto memory_create_failed;
 	}
 
-    // создаем массив ячеек:
-    m->mem = (MemoryCell*) calloc(m->memory_size, sizeof(m->mem[0]));
-    
+    // создаем пустую таблицу страниц, сами страницы выделяются по требованию:
+    m->page_mask = INITIAL_PAGE_TABLE_SIZE - 1;
+    m->pages = calloc(INITIAL_PAGE_TABLE_SIZE, sizeof(m->pages[0]));
+
     return (AbstractMemory*) m;
 
 memory_create_failed:
@@ -259,6 +913,12 @@ memory_create_failed:
 	return NULL;
 }
 
+int
+memory_failed(AbstractMemory *a)
+{
+    return ((Memory *) a)->failed;
+}
+
 /*
  * Local variables:
  *  c-basic-offset: 4
@@ -11,17 +11,82 @@
 #include "abstract_memory.h"
 #include "parse_config.h"
 
+#include <stdio.h>
+
+/*!
+  Двоичный образ ОЗУ. Файл начинается с заголовка длины MEMORY_IMAGE_HEADER_SIZE:
+  сигнатура MEMORY_IMAGE_MAGIC (8 байт), версия формата (4 байта), размер страницы (4 байта),
+  размер ОЗУ (8 байт) и число страниц в образе (8 байт). Далее следуют записи страниц,
+  содержащих хотя бы одну известную ячейку, в порядке возрастания адресов: номер страницы
+  (адрес ее начала, деленный на размер страницы, 8 байт), значения ячеек (размер страницы байт,
+  значения неизвестных ячеек равны 0) и битовая маска известности ячеек (размер страницы / 8 байт,
+  младшие биты байта соответствуют младшим адресам).
+  Все многобайтовые поля записаны в порядке little-endian. Одинаковое содержимое ОЗУ
+  всегда дает побайтно одинаковый образ.
+ */
+#define MEMORY_IMAGE_MAGIC "CSMEMIMG"
+
+enum
+{
+    MEMORY_IMAGE_VERSION = 1, //!< Версия формата двоичного образа ОЗУ
+    MEMORY_IMAGE_HEADER_SIZE = 32 //!< Размер заголовка двоичного образа ОЗУ
+};
+
 /*!
   Создать модель ОЗУ
   \param cfg Указатель на структуру, хранящую конфигурационные параметры
   \param var_prefix Префикс имен параметров
   \param info Указатель на структуру, хранящую статистику моделирования
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно: модель учитывает
+  только время доступа и не хранит данные
   \return Указатель на структуру описания модели ОЗУ (в виде указателя на базовую структуру)
  */
 AbstractMemory *memory_create(
 	const ConfigFile *cfg,
 	const char *var_prefix,
-	StatisticsInfo *info);
+	StatisticsInfo *info,
+	int tag_only);
+
+/*!
+  Напечатать содержимое ОЗУ в сжатом виде (как hexdump): строки в том же формате, что и у
+  print_dump, но серия строк, совпадающих по содержимому с предыдущей строкой, заменяется
+  одной строкой "*"; последняя строка содержит только размер ОЗУ. Время и размер вывода
+  зависят от числа использованных страниц, а не от размера ОЗУ.
+  \param a Указатель на структуру описания модели ОЗУ, созданной memory_create
+  \param out_f Файл, куда печатается содержимое памяти
+ */
+void memory_print_compact_dump(AbstractMemory *a, FILE *out_f);
+
+/*!
+  Записать содержимое ОЗУ в файл в виде двоичного образа. Образ пишется в файл path.tmp,
+  который затем переименовывается в path, так что path может совпадать с образом, загруженным
+  memory_load_image
+  \param a Указатель на структуру описания модели ОЗУ, созданной memory_create
+  \param path Путь к создаваемому файлу
+  \param log_f Файл для вывода сообщений об ошибках
+  \return 0 в случае успеха, -1 в случае ошибки записи
+ */
+int memory_write_image(AbstractMemory *a, const char *path, FILE *log_f);
+
+/*!
+  Загрузить в ОЗУ начальное содержимое из двоичного образа. Файл отображается в память,
+  страницы образа используются без копирования (копируются ядром при первой записи).
+  \param a Указатель на структуру описания модели ОЗУ, созданной memory_create
+  (еще не выполнявшую обращений)
+  \param path Путь к файлу образа
+  \param log_f Файл для вывода сообщений об ошибках
+  \return 0 в случае успеха, -1 в случае ошибки
+ */
+int memory_load_image(AbstractMemory *a, const char *path, FILE *log_f);
+
+/*!
+  Проверить, хватило ли модели ОЗУ памяти. При нехватке памяти модель печатает сообщение
+  и продолжает работу, но не сохраняет содержимое новых страниц и не печатает дамп,
+  поэтому вызывающий должен завершиться с ошибкой.
+  \param a Указатель на структуру описания модели ОЗУ, созданной memory_create
+  \return Ненулевое значение, если памяти не хватило
+ */
+int memory_failed(AbstractMemory *a);
 
 #endif
 
@@ -0,0 +1,630 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "mrc.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+  Диапазоны параметров кривых
+ */
+enum
+{
+    MIN_BLOCK_SHIFT = 4, //!< Логарифм наименьшего размера блока
+    BLOCK_SIZE_COUNT = 3, //!< Число размеров блока (16, 32, 64)
+    MIN_CURVE_SIZE = KiB, //!< Наименьший размер кеша
+    MAX_CURVE_SIZE = 16 * MiB, //!< Наибольший размер кеша
+    MAX_CURVE_SHIFT = 24, //!< Логарифм наибольшего размера кеша
+    MAX_WAYS = 16, //!< Наибольшее число блоков в наборе для множественно-ассоциативного кеша
+    CURVE_SIZE_COUNT = MAX_CURVE_SHIFT - 10 + 1, //!< Число размеров кеша
+    INITIAL_CAPACITY = 1 << 16, //!< Начальный размер дерева Фенвика и хеш-таблицы
+    SAMPLE_GROUPS = 16, //!< Число независимых групп выборки (по младшим разрядам хеша блока)
+    SAMPLE_MIN_BLOCKS = 64, //!< Наименьшее число блоков выборки в кеше, для которого печатается граница погрешности
+    SAMPLE_HASH_BITS = 24 //!< Разрядность значения хеша, сравниваемого с порогом выборки
+};
+
+/*!
+  Вычисление LRU-расстояний в полноассоциативном кеше. Каждому обращению соответствует позиция
+  во времени; дерево Фенвика хранит отметки позиций последних обращений к блокам, так что
+  расстояние равно числу отметок после предыдущего обращения к блоку. Когда позиции
+  заканчиваются, отметки переупаковываются в начало (при необходимости с удвоением размера).
+  \brief Анализатор полноассоциативного кеша
+ */
+typedef struct StackAnalyzer
+{
+    memaddr_t *keys; //!< Хеш-таблица: номер блока + 1, 0 - пустая ячейка
+    int *times; //!< Хеш-таблица: позиция последнего обращения к блоку
+    int hash_mask; //!< Размер хеш-таблицы минус 1
+    int hash_shift; //!< Сдвиг, выделяющий номер ячейки хеш-таблицы из 64-битного хеша
+    int hash_used; //!< Число занятых ячеек хеш-таблицы
+    int *tree; //!< Дерево Фенвика (индексы с 1)
+    memaddr_t *owners; //!< Номер блока + 1 для каждой отмеченной позиции, 0 - позиция не отмечена
+    int capacity; //!< Число позиций
+    int now; //!< Следующая свободная позиция
+    int live; //!< Число отмеченных позиций (различных блоков)
+} StackAnalyzer;
+
+/*!
+  Вычисление LRU-расстояний (не более depth) в наборах множественно-ассоциативного кеша:
+  каждый набор хранит depth последних использованных блоков, начиная с последнего
+  \brief Анализатор множественно-ассоциативного кеша с фиксированным числом наборов
+ */
+typedef struct SetAnalyzer
+{
+    int set_shift; //!< Логарифм числа наборов
+    int depth; //!< Число хранимых блоков набора
+    memaddr_t *tags; //!< Теги блоков (+1, 0 - нет блока), depth элементов на набор
+    long long hist[MAX_WAYS]; //!< Число чтений с каждым LRU-расстоянием
+} SetAnalyzer;
+
+/*!
+  Элемент кучи блоков выборки фиксированного размера
+ */
+typedef struct SampleHeapItem
+{
+    unsigned value; //!< Значение хеша блока, сравниваемое с порогом
+    memaddr_t block; //!< Номер блока
+} SampleHeapItem;
+
+/*!
+  Накопленные чтения блоков выборки одной группы. Группы (по младшим разрядам хеша)
+  используются для оценки погрешности по разбросу их долей попаданий.
+  \brief Группа выборки
+ */
+typedef struct SampleGroup
+{
+    double reads; //!< Взвешенное число чтений блоков группы
+    double hits[CURVE_SIZE_COUNT]; //!< Взвешенное число чтений, впервые попадающих в кеш данного размера
+} SampleGroup;
+
+/*!
+  Выборка блоков (SHARDS): блок учитывается, если значение его хеша меньше порога,
+  LRU-расстояния между учтенными блоками масштабируются делением на долю выборки.
+  При ограничении размера выборки порог понижается так, чтобы в ней оставалось
+  не более max_blocks блоков; блоки с наибольшими значениями хеша удаляются из выборки.
+  Каждое чтение учитывается с весом, обратным доле выборки в момент чтения.
+  \brief Выборка блоков
+ */
+typedef struct SampleSet
+{
+    StackAnalyzer stack; //!< LRU-расстояния между блоками выборки
+    unsigned threshold; //!< Порог значения хеша (не более 2^SAMPLE_HASH_BITS)
+    int max_blocks; //!< Наибольшее число блоков в выборке, 0 - размер не ограничен
+    SampleHeapItem *heap; //!< Блоки выборки (куча с наибольшим значением хеша в вершине)
+    int heap_count; //!< Число элементов кучи
+    SampleGroup groups[SAMPLE_GROUPS]; //!< Группы блоков выборки
+} SampleSet;
+
+/*!
+  Анализаторы для одного размера блока
+  \brief Кривые одного размера блока
+ */
+typedef struct BlockCurve
+{
+    int block_shift; //!< Логарифм размера блока
+    StackAnalyzer full; //!< Анализатор для одного набора (полноассоциативный кеш)
+    long long *hist; //!< Число чтений с каждым LRU-расстоянием в полноассоциативном кеше
+    int hist_size; //!< Размер гистограммы (наибольшее число блоков в кеше)
+    int set_count; //!< Число анализаторов наборов
+    SetAnalyzer *sets; //!< Анализатор sets[i] соответствует 2^(i+1) наборам
+    SampleSet *sample; //!< Выборка блоков (только в режиме выборки, тогда остальные анализаторы не используются)
+} BlockCurve;
+
+struct MissRatioCurve
+{
+    BlockCurve curves[BLOCK_SIZE_COUNT]; //!< Кривые для каждого размера блока
+    long long reads; //!< Число чтений
+    int sampled; //!< Строятся ли приближенные кривые по выборке блоков
+};
+
+/*!
+  Начальная ячейка хеш-таблицы для ключа: старшие разряды произведения, зависящие от всех
+  разрядов номера блока (иначе номера с одинаковым остатком по размеру таблицы совпадают)
+ */
+static inline int
+stack_hash(const StackAnalyzer *a, memaddr_t key)
+{
+    return (key * 0x9E3779B97F4A7C15ULL) >> a->hash_shift;
+}
+
+/*!
+  Ячейка хеш-таблицы для блока: либо хранящая его, либо пустая
+ */
+static inline int
+stack_slot(const StackAnalyzer *a, memaddr_t key)
+{
+    int i = stack_hash(a, key);
+    while (a->keys[i] && a->keys[i] != key) {
+        i = (i + 1) & a->hash_mask;
+    }
+    return i;
+}
+
+/*!
+  Удвоить хеш-таблицу
+ */
+static void
+stack_grow_hash(StackAnalyzer *a)
+{
+    memaddr_t *keys = a->keys;
+    int *times = a->times;
+    int size = a->hash_mask + 1;
+    a->hash_mask = 2 * size - 1;
+    a->hash_shift--;
+    a->keys = calloc(2 * size, sizeof(*a->keys));
+    a->times = malloc(2 * size * sizeof(*a->times));
+    for (int i = 0; i < size; i++) {
+        if (keys[i]) {
+            int j = stack_slot(a, keys[i]);
+            a->keys[j] = keys[i];
+            a->times[j] = times[i];
+        }
+    }
+    free(keys);
+    free(times);
+}
+
+static inline void
+stack_tree_add(StackAnalyzer *a, int pos, int delta)
+{
+    for (int i = pos + 1; i <= a->capacity; i += i & -i) {
+        a->tree[i] += delta;
+    }
+}
+
+/*!
+  Число отмеченных позиций в [0, pos]
+ */
+static inline int
+stack_tree_prefix(const StackAnalyzer *a, int pos)
+{
+    int sum = 0;
+    for (int i = pos + 1; i > 0; i -= i & -i) {
+        sum += a->tree[i];
+    }
+    return sum;
+}
+
+/*!
+  Переупаковать отмеченные позиции в начало, сохранив их порядок, и перестроить дерево
+ */
+static void
+stack_compact(StackAnalyzer *a)
+{
+    int n = 0;
+    for (int pos = 0; pos < a->now; pos++) {
+        if (a->owners[pos]) {
+            a->times[stack_slot(a, a->owners[pos])] = n;
+            a->owners[n++] = a->owners[pos];
+        }
+    }
+    if (2 * n > a->capacity) {
+        a->capacity *= 2;
+        a->owners = realloc(a->owners, a->capacity * sizeof(*a->owners));
+        a->tree = realloc(a->tree, (a->capacity + 1) * sizeof(*a->tree));
+    }
+    memset(a->owners + n, 0, (a->capacity - n) * sizeof(*a->owners));
+    // построение дерева Фенвика за линейное время:
+    memset(a->tree, 0, (a->capacity + 1) * sizeof(*a->tree));
+    for (int i = 1; i <= a->capacity; i++) {
+        a->tree[i] += (i <= n);
+        int j = i + (i & -i);
+        if (j <= a->capacity) {
+            a->tree[j] += a->tree[i];
+        }
+    }
+    a->now = n;
+}
+
+static void
+stack_init(StackAnalyzer *a)
+{
+    a->hash_mask = INITIAL_CAPACITY - 1;
+    a->hash_shift = 64 - __builtin_ctz(INITIAL_CAPACITY);
+    a->keys = calloc(INITIAL_CAPACITY, sizeof(*a->keys));
+    a->times = malloc(INITIAL_CAPACITY * sizeof(*a->times));
+    a->capacity = INITIAL_CAPACITY;
+    a->tree = calloc(a->capacity + 1, sizeof(*a->tree));
+    a->owners = calloc(a->capacity, sizeof(*a->owners));
+}
+
+static void
+stack_destroy(StackAnalyzer *a)
+{
+    free(a->keys);
+    free(a->times);
+    free(a->tree);
+    free(a->owners);
+}
+
+/*!
+  Учесть обращение к блоку
+  \param a Указатель на анализатор
+  \param block Номер блока
+  \return LRU-расстояние, -1 - если это первое обращение к блоку
+ */
+static int
+stack_access(StackAnalyzer *a, memaddr_t block)
+{
+    if (a->now == a->capacity) {
+        stack_compact(a);
+    }
+    memaddr_t key = block + 1;
+    int distance = -1;
+    int i = stack_slot(a, key);
+    if (a->keys[i]) {
+        int pos = a->times[i];
+        distance = a->live - stack_tree_prefix(a, pos);
+        stack_tree_add(a, pos, -1);
+        a->owners[pos] = 0;
+    } else {
+        a->keys[i] = key;
+        a->live++;
+        if (2 * ++a->hash_used > a->hash_mask + 1) {
+            stack_grow_hash(a);
+            i = stack_slot(a, key);
+        }
+    }
+    a->times[i] = a->now;
+    a->owners[a->now] = key;
+    stack_tree_add(a, a->now++, 1);
+    return distance;
+}
+
+/*!
+  Удалить блок из анализатора. Последующие элементы цепочки хеш-таблицы сдвигаются назад.
+  \param a Указатель на анализатор
+  \param block Номер блока (обязан присутствовать в анализаторе)
+ */
+static void
+stack_remove(StackAnalyzer *a, memaddr_t block)
+{
+    int i = stack_slot(a, block + 1);
+    int pos = a->times[i];
+    stack_tree_add(a, pos, -1);
+    a->owners[pos] = 0;
+    a->live--;
+    a->hash_used--;
+    for (int j = (i + 1) & a->hash_mask; a->keys[j]; j = (j + 1) & a->hash_mask) {
+        int home = stack_hash(a, a->keys[j]);
+        // элемент можно сдвинуть в i, если его начальная ячейка не лежит циклически в (i, j]:
+        if (((j - home) & a->hash_mask) >= ((j - i) & a->hash_mask)) {
+            a->keys[i] = a->keys[j];
+            a->times[i] = a->times[j];
+            i = j;
+        }
+    }
+    a->keys[i] = 0;
+}
+
+/*!
+  Учесть обращение к блоку в анализаторе наборов
+ */
+static inline void
+set_access(SetAnalyzer *a, memaddr_t block, int is_read)
+{
+    memaddr_t *row = a->tags + (size_t) (block & ((1U << a->set_shift) - 1)) * a->depth;
+    memaddr_t tag = (block >> a->set_shift) + 1;
+    int p = 0;
+    while (p < a->depth && row[p] != tag) {
+        p++;
+    }
+    if (p < a->depth) {
+        if (is_read) {
+            a->hist[p]++;
+        }
+    } else {
+        p = a->depth - 1;
+    }
+    memmove(row + 1, row, p * sizeof(*row));
+    row[0] = tag;
+}
+
+/*!
+  Перемешать разряды номера блока (хеш для выборки)
+ */
+static inline unsigned
+sample_hash(unsigned x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+    return x;
+}
+
+/*!
+  Добавить блок в кучу выборки
+ */
+static void
+sample_heap_push(SampleSet *g, unsigned value, memaddr_t block)
+{
+    int i = g->heap_count++;
+    while (i > 0 && g->heap[(i - 1) / 2].value < value) {
+        g->heap[i] = g->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    g->heap[i] = (SampleHeapItem) { value, block };
+}
+
+/*!
+  Извлечь из кучи выборки блок с наибольшим значением хеша
+ */
+static SampleHeapItem
+sample_heap_pop(SampleSet *g)
+{
+    SampleHeapItem top = g->heap[0];
+    SampleHeapItem last = g->heap[--g->heap_count];
+    int i = 0;
+    while (2 * i + 1 < g->heap_count) {
+        int j = 2 * i + 1;
+        if (j + 1 < g->heap_count && g->heap[j + 1].value > g->heap[j].value) {
+            j++;
+        }
+        if (g->heap[j].value <= last.value) {
+            break;
+        }
+        g->heap[i] = g->heap[j];
+        i = j;
+    }
+    g->heap[i] = last;
+    return top;
+}
+
+/*!
+  Учесть обращение к блоку в режиме выборки
+  \param c Указатель на кривые размера блока
+  \param block Номер блока
+  \param is_read Ненулевое значение для чтения
+ */
+static void
+sample_access(BlockCurve *c, memaddr_t block, int is_read)
+{
+    unsigned h = sample_hash((unsigned) (block ^ block >> 32));
+    SampleSet *g = c->sample;
+    unsigned value = h >> (32 - SAMPLE_HASH_BITS);
+    if (value >= g->threshold) {
+        return;
+    }
+    int distance = stack_access(&g->stack, block);
+    if (distance < 0 && g->max_blocks) {
+        sample_heap_push(g, value, block);
+        if (g->stack.live > g->max_blocks) {
+            // понижаем порог до наибольшего значения хеша и удаляем блоки, не прошедшие его:
+            g->threshold = g->heap[0].value;
+            while (g->heap_count && g->heap[0].value >= g->threshold) {
+                stack_remove(&g->stack, sample_heap_pop(g).block);
+            }
+            if (value >= g->threshold) {
+                return;
+            }
+        }
+    }
+    if (!is_read) {
+        return;
+    }
+    // выборка содержит долю threshold / 2^SAMPLE_HASH_BITS всех блоков:
+    double scale = (double) (1U << SAMPLE_HASH_BITS) / g->threshold;
+    SampleGroup *group = &g->groups[h % SAMPLE_GROUPS];
+    group->reads += scale;
+    if (distance >= 0) {
+        double blocks = distance * scale;
+        for (int k = 0; k < CURVE_SIZE_COUNT; k++) {
+            if (blocks < (double) (MIN_CURVE_SIZE >> c->block_shift << k)) {
+                group->hits[k] += scale;
+                break;
+            }
+        }
+    }
+}
+
+MissRatioCurve *
+mrc_create_sampled(double rate, int sample_size)
+{
+    MissRatioCurve *m = calloc(1, sizeof(*m));
+    m->sampled = 1;
+    // выборка фиксированного размера начинается со всех блоков:
+    unsigned threshold = 1U << SAMPLE_HASH_BITS;
+    if (!sample_size && rate * threshold < threshold) {
+        threshold = (rate * threshold < 1) ? 1 : (unsigned) (rate * threshold);
+    }
+    for (int b = 0; b < BLOCK_SIZE_COUNT; b++) {
+        BlockCurve *c = &m->curves[b];
+        c->block_shift = MIN_BLOCK_SHIFT + b;
+        SampleSet *g = c->sample = calloc(1, sizeof(*c->sample));
+        stack_init(&g->stack);
+        g->threshold = threshold;
+        g->max_blocks = sample_size;
+        if (sample_size) {
+            g->heap = malloc((sample_size + 1) * sizeof(*g->heap));
+        }
+    }
+    return m;
+}
+
+MissRatioCurve *
+mrc_create(void)
+{
+    MissRatioCurve *m = calloc(1, sizeof(*m));
+    for (int b = 0; b < BLOCK_SIZE_COUNT; b++) {
+        BlockCurve *c = &m->curves[b];
+        c->block_shift = MIN_BLOCK_SHIFT + b;
+        int max_blocks_shift = MAX_CURVE_SHIFT - c->block_shift;
+        stack_init(&c->full);
+        c->hist_size = 1 << max_blocks_shift;
+        c->hist = calloc(c->hist_size, sizeof(*c->hist));
+        // наибольшее число наборов - у кеша прямого отображения наибольшего размера:
+        c->set_count = max_blocks_shift;
+        c->sets = calloc(c->set_count, sizeof(*c->sets));
+        for (int i = 0; i < c->set_count; i++) {
+            SetAnalyzer *a = &c->sets[i];
+            a->set_shift = i + 1;
+            a->depth = 1 << (max_blocks_shift - a->set_shift);
+            if (a->depth > MAX_WAYS) {
+                a->depth = MAX_WAYS;
+            }
+            a->tags = calloc((size_t) a->depth << a->set_shift, sizeof(*a->tags));
+        }
+    }
+    return m;
+}
+
+MissRatioCurve *
+mrc_free(MissRatioCurve *m)
+{
+    if (m) {
+        for (int b = 0; b < BLOCK_SIZE_COUNT; b++) {
+            BlockCurve *c = &m->curves[b];
+            if (c->sample) {
+                stack_destroy(&c->sample->stack);
+                free(c->sample->heap);
+                free(c->sample);
+                continue;
+            }
+            stack_destroy(&c->full);
+            free(c->hist);
+            for (int i = 0; i < c->set_count; i++) {
+                free(c->sets[i].tags);
+            }
+            free(c->sets);
+        }
+        free(m);
+    }
+    return NULL;
+}
+
+void
+mrc_access(MissRatioCurve *m, const TraceStep *ts)
+{
+    if (ts->op != 'R' && ts->op != 'W') {
+        return;
+    }
+    int is_read = (ts->op == 'R');
+    m->reads += is_read;
+    for (int b = 0; b < BLOCK_SIZE_COUNT; b++) {
+        BlockCurve *c = &m->curves[b];
+        memaddr_t block = ts->addr >> c->block_shift;
+        if (m->sampled) {
+            sample_access(c, block, is_read);
+            continue;
+        }
+        int distance = stack_access(&c->full, block);
+        if (is_read && distance >= 0 && distance < c->hist_size) {
+            c->hist[distance]++;
+        }
+        for (int i = 0; i < c->set_count; i++) {
+            set_access(&c->sets[i], block, is_read);
+        }
+    }
+}
+
+/*!
+  Напечатать одну строку кривой
+ */
+static void
+mrc_print_row(MissRatioCurve *m, int block_size, const char *assoc, int cache_size, long long hits, FILE *out_f)
+{
+    fprintf(out_f, "%d\t%s\t%d\t%lld\t%.6f\n", block_size, assoc, cache_size, hits,
+        m->reads ? (double) hits / m->reads : 0.0);
+}
+
+/*!
+  Напечатать приближенные кривые полноассоциативного кеша. Доля попаданий оценивается
+  отношением взвешенных сумм по всем группам, граница погрешности - 1.96 стандартного
+  отклонения этой оценки, вычисленного по разбросу долей попаданий отдельных групп блоков.
+  Разброс групп не учитывает смещения от масштабирования расстояний: число блоков выборки,
+  помещающихся в кеш, известно с относительной погрешностью порядка 1 / sqrt(число блоков),
+  поэтому для кешей меньше SAMPLE_MIN_BLOCKS блоков выборки граница не печатается ("-").
+ */
+static void
+mrc_print_sampled(MissRatioCurve *m, FILE *out_f)
+{
+    fprintf(out_f, "block size\tassociativity\tcache size\tread hits\tread hit ratio\terror\n");
+    for (int b = 0; b < BLOCK_SIZE_COUNT; b++) {
+        const SampleGroup *groups = m->curves[b].sample->groups;
+        int block_size = 1 << m->curves[b].block_shift;
+        double rate = (double) m->curves[b].sample->threshold / (1U << SAMPLE_HASH_BITS);
+        double group_hits[SAMPLE_GROUPS] = { 0 };
+        for (int k = 0; k < CURVE_SIZE_COUNT; k++) {
+            double hits = 0, reads = 0;
+            int n = 0;
+            for (int i = 0; i < SAMPLE_GROUPS; i++) {
+                group_hits[i] += groups[i].hits[k];
+                hits += group_hits[i];
+                reads += groups[i].reads;
+                n += (groups[i].reads > 0);
+            }
+            double ratio = (reads > 0) ? hits / reads : 0.0;
+            fprintf(out_f, "%d\tfull\t%d\t%.0f\t%.6f", block_size, MIN_CURVE_SIZE << k,
+                ratio * m->reads, ratio);
+            double cache_blocks = (double) (MIN_CURVE_SIZE >> m->curves[b].block_shift << k);
+            if (n < 2 || cache_blocks * rate < SAMPLE_MIN_BLOCKS) {
+                fprintf(out_f, "\t-\n");
+                continue;
+            }
+            double mean_reads = reads / n, sum = 0;
+            for (int i = 0; i < SAMPLE_GROUPS; i++) {
+                if (groups[i].reads > 0) {
+                    double dev = (group_hits[i] - ratio * groups[i].reads) / mean_reads;
+                    sum += dev * dev;
+                }
+            }
+            fprintf(out_f, "\t%.6f\n", 1.96 * sqrt(sum / n / (n - 1)));
+        }
+    }
+}
+
+void
+mrc_print(MissRatioCurve *m, FILE *out_f)
+{
+    if (m->sampled) {
+        mrc_print_sampled(m, out_f);
+        return;
+    }
+    fprintf(out_f, "block size\tassociativity\tcache size\tread hits\tread hit ratio\n");
+    for (int b = 0; b < BLOCK_SIZE_COUNT; b++) {
+        BlockCurve *c = &m->curves[b];
+        int block_size = 1 << c->block_shift;
+        for (int ways = 1; ways <= MAX_WAYS; ways *= 2) {
+            char assoc[16];
+            if (ways == 1) {
+                strcpy(assoc, "direct");
+            } else {
+                snprintf(assoc, sizeof(assoc), "%d", ways);
+            }
+            for (int size = MIN_CURVE_SIZE; size <= MAX_CURVE_SIZE; size *= 2) {
+                int sets = size / block_size / ways;
+                const long long *hist = c->hist;
+                if (sets > 1) {
+                    int i = 0;
+                    while ((2 << i) < sets) {
+                        i++;
+                    }
+                    hist = c->sets[i].hist;
+                }
+                long long hits = 0;
+                for (int d = 0; d < ways; d++) {
+                    hits += hist[d];
+                }
+                mrc_print_row(m, block_size, assoc, size, hits, out_f);
+            }
+        }
+        // полноассоциативный кеш: число попаданий - сумма гистограммы до числа блоков кеша
+        long long hits = 0;
+        int d = 0;
+        for (int size = MIN_CURVE_SIZE; size <= MAX_CURVE_SIZE; size *= 2) {
+            for (; d < size / block_size; d++) {
+                hits += c->hist[d];
+            }
+            mrc_print_row(m, block_size, "full", size, hits, out_f);
+        }
+    }
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
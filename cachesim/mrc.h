@@ -0,0 +1,77 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file mrc.h
+  \brief Построение кривых попаданий LRU-кеша за один проход по трассе
+ */
+
+#ifndef MRC_H_INCLUDED
+#define MRC_H_INCLUDED
+
+#include "trace.h"
+
+#include <stdio.h>
+
+/*!
+  Структура хранит состояние построения кривых попаданий. Полное описание структуры
+  находится в mrc.c
+ */
+struct MissRatioCurve;
+typedef struct MissRatioCurve MissRatioCurve;
+
+/*!
+  Создать дескриптор построения кривых. Кривые строятся для всех допустимых размеров блока
+  (16, 32, 64), степеней ассоциативности direct, 2, 4, 8, 16, full и размеров кеша от 1 KiB
+  до 16 MiB (степени двойки) для кеша с отложенной записью и замещением LRU.
+  Для каждого размера блока и числа наборов вычисляются LRU-расстояния (число различных блоков
+  набора, к которым были обращения после предыдущего обращения к тому же блоку); обращение
+  попадает в кеш, если расстояние меньше числа блоков в наборе. Для полноассоциативного кеша
+  расстояния вычисляются деревом Фенвика за O(log n), для остальных достаточно хранить
+  в каждом наборе не более 16 последних блоков.
+  \return Указатель на дескриптор
+ */
+MissRatioCurve *mrc_create(void);
+
+/*!
+  Создать дескриптор построения приближенных кривых по выборке блоков (SHARDS). Учитываются
+  только блоки, значение хеша номера которых попадает в выборку; LRU-расстояния масштабируются
+  обратно пропорционально доле выборки. Строятся только кривые полноассоциативного кеша,
+  для каждой точки печатается граница погрешности (95%), вычисленная по разбросу долей попаданий
+  16 групп блоков выборки (группа определяется младшими разрядами хеша). Для кешей, в которых
+  помещается меньше 64 блоков выборки, оценка смещена сильнее этой границы и граница не печатается.
+  \param rate Доля блоков в выборке (0, 1], используется, если sample_size равен 0
+  \param sample_size Наибольшее число блоков в выборке (для каждого размера блока), 0 - доля выборки
+  фиксирована. При ограниченном размере используемая память не зависит от числа различных блоков трассы.
+  \return Указатель на дескриптор
+ */
+MissRatioCurve *mrc_create_sampled(double rate, int sample_size);
+
+/*!
+  Освободить ресурсы
+  \param m Указатель на дескриптор
+  \return NULL
+ */
+MissRatioCurve *mrc_free(MissRatioCurve *m);
+
+/*!
+  Учесть шаг трассы
+  \param m Указатель на дескриптор
+  \param ts Указатель на структуру описания шага трассы
+ */
+void mrc_access(MissRatioCurve *m, const TraceStep *ts);
+
+/*!
+  Распечатать кривые: по строке (поля разделены табуляцией) на каждое сочетание размера блока,
+  ассоциативности и размера кеша с числом попаданий при чтении и их долей среди всех чтений
+  \param m Указатель на дескриптор
+  \param out_f Файл вывода
+ */
+void mrc_print(MissRatioCurve *m, FILE *out_f);
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
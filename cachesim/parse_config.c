@@ -244,6 +244,23 @@ config_file_get_int(const ConfigFile *cfg, const char *name, int *p_value)
     return 1;
 }
 
+int
+config_file_get_llong(const ConfigFile *cfg, const char *name, long long *p_value)
+{
+    const char *str = config_file_get(cfg, name);
+    if (!str) {
+        return 0;
+    }
+    char *eptr = NULL;
+    errno = 0;
+    long long value = strtoll(str, &eptr, 10);
+    if (*eptr || errno) {
+        return -1;
+    }
+    *p_value = value;
+    return 1;
+}
+
 void
 config_file_print(const ConfigFile *cfg)
 {
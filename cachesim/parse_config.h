@@ -57,6 +57,16 @@ const char *config_file_get(const ConfigFile *cfg, const char *name);
  */
 int config_file_get_int(const ConfigFile *cfg, const char *name, int *p_value);
 
+/*!
+  Функция считывает значение заданного конфигурационного параметра в виде целого числа типа long long
+  (например, размера адресного пространства, не представимого в int)
+  \param cfg Структура, хранящая конфигурационные параметры
+  \param name Имя конфигурационного параметра
+  \param p_value Указатель на переменную, в которую будет записано значение конфигурационного параметра
+  \return То же, что и config_file_get_int
+ */
+int config_file_get_llong(const ConfigFile *cfg, const char *name, long long *p_value);
+
 /*!
     Функция печатает на стандартный поток вывода параметры, определённые в конфигурационном файле в формате
     имя = "значение"
@@ -3,6 +3,7 @@
 #include "random.h"
 #include "common.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
 
@@ -18,7 +19,9 @@ random_free(Random *rnd)
 int
 random_next(Random *rnd, int n)
 {
-    return (int) (rand() / (RAND_MAX + 1.0) * n);
+    int32_t value;
+    random_r(&rnd->data, &value);
+    return (int) (value / (RAND_MAX + 1.0) * n);
 }
 
 static RandomOps random_ops =
@@ -41,10 +44,11 @@ random_create(ConfigFile *cfg)
         rnd->seed = time(NULL);
     } else if (r < 0 || rnd->seed <= 0) {
         error_invalid("random_create", buf);
-        free(rnd); rnd = NULL;
+        free(rnd);
+        return NULL;
     }
     
-    srand(rnd->seed);
+    initstate_r(rnd->seed, rnd->state, sizeof(rnd->state), &rnd->data);
     return rnd;
 }
 
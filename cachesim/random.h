@@ -10,6 +10,8 @@
 
 #include "parse_config.h"
 
+#include <stdlib.h>
+
 struct Random;
 typedef struct Random Random;
 
@@ -35,14 +37,23 @@ typedef struct RandomOps
     int (*next)(Random *rnd, int n);
 } RandomOps;
 
+enum
+{
+    RANDOM_STATE_SIZE = 128 //!< Размер состояния ГПСЧ (совпадает с размером состояния функции rand() в glibc)
+};
+
 /*!
-  Описание генератора псевдослучайных чисел
-  \brief Дескриптор ГПСЧ на основе стандартной функции rand()
+  Описание генератора псевдослучайных чисел. Каждый дескриптор хранит собственное состояние,
+  поэтому независимые модели могут работать в разных потоках; последовательность чисел
+  совпадает с последовательностью rand() после srand(seed).
+  \brief Дескриптор ГПСЧ на основе функции random_r()
  */
 typedef struct Random
 {
     RandomOps *ops; //!< Операции со случайными числами
     int seed; //!< Затравка ГПСЧ (считывается из конфигурационного файла)
+    struct random_data data; //!< Описание состояния ГПСЧ
+    char state[RANDOM_STATE_SIZE]; //!< Состояние ГПСЧ
 } Random;
 
 
@@ -0,0 +1,1152 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "set_cache.h"
+#include "lfu.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+  Ограничения значений параметров
+ */
+enum
+{
+    MAX_CACHE_SIZE = 16 * MiB, //!< Максимальный поддерживаемый размер кеша
+    MAX_READ_TIME = 100000, //!< Максимальное время чтения из кеша в тактах
+    MAX_WRITE_TIME = MAX_READ_TIME, //!< Максимальное время записи в кеш в тактах
+};
+
+/*!
+  Описание одного блока множественно-ассоциативного кеша
+  \brief Блок множественно-ассоциативного кеша
+ */
+typedef struct SetCacheBlock
+{
+    int dirty; //!< Флаг того, что блок содержит данные, не сброшенные в память, только для write back кеша
+    unsigned long long stamp; //!< Время последнего обращения к блоку (только для замещения LRU и LFU)
+    int lfu_count; //!< Счетчик обращений LFU на момент эпохи lfu_epoch
+    unsigned long long lfu_epoch; //!< Эпоха LFU последнего обращения к блоку
+} SetCacheBlock;
+
+/*! Значение тега в случае, если блок свободен (не бывает адресом начала блока) */
+#define NO_BLOCK ((memaddr_t) -1)
+
+struct SetCache;
+typedef struct SetCache SetCache;
+
+/*!
+  Дополнительные операции, настраивающие поведение множественно-ассоциативного кеша
+  \brief Доп. операции множественно-ассоциативного кеша
+ */
+typedef struct SetCacheOps
+{
+    /*!
+      Функция должна выполнить синхронизацию между блоком кеша и памятью. Для кеша с прямой
+      записью функция не делает ничего, для кеша с отложенной записью функция записывает
+      грязный блок в память.
+      \param c Указатель на дескриптор кеша
+      \param b Указатель на финализируемый блок
+     */
+    void (*finalize)(SetCache *c, SetCacheBlock *b);
+    
+    /*!
+     Поместить блок ОЗУ в множественно-ассоциативный кеш
+     \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+     \param aligned_addr Адрес начала искомого блока
+     \return Указатель на соответствующий блок кеша
+    */
+    SetCacheBlock *(*cache_place)(SetCache *c, memaddr_t aligned_addr);
+
+    /*!
+     Учесть обращение к блоку, уже находящемуся в кеше
+     \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+     \param b Указатель на блок, к которому выполнено обращение
+    */
+    void (*touch)(SetCache *c, SetCacheBlock *b);
+} SetCacheOps;
+
+/*!
+  Множественно-ассоциативный кеш
+  \brief Дескриптор множественно-ассоциативного кеша
+ */
+struct SetCache
+{
+    AbstractMemory b; //!< Базовые поля
+    SetCacheOps set_ops; //!< Дополнительные операции множественно-ассоциативного кеша
+    Random *rnd; //!< Элемент случайности
+    SetCacheBlock *blocks; //!< Блоки кеша, блоки одного набора расположены подряд
+    memaddr_t *tags; //!< Адреса, по которым в основной памяти находятся блоки (теги), NO_BLOCK - блок свободен
+    AbstractMemory *mem; //!< Нижележащая память
+    unsigned char *data; //!< Ячейки памяти, хранящиеся в блоках кеша (см. memory_cells_arena_create), NULL - кеш не хранит данные
+    int cache_size; //!< Размер кеша (считывается из конф. файла)
+    int block_size; //!< Размер одного блока кеша (считывается из конф. файла)
+    int block_count; //!< Количество блоков кеша
+    int ways; //!< Количество блоков в наборе (считывается из конф. файла)
+    int set_count; //!< Количество наборов
+    int set_mask; //!< set_count - 1 (используется специализированными ядрами, см. set_cache_kernel_ops)
+    unsigned long long clock; //!< Счетчик обращений, задающий метки времени блоков для LRU и LFU
+    LfuConfig lfu; //!< Параметры стратегии LFU
+    int lfu_refs; //!< Число обращений с начала текущей эпохи LFU
+    unsigned long long lfu_epoch; //!< Текущая эпоха LFU (число выполненных старений)
+    int cache_read_time; //!< Время выполнения чтения из кеша (считывается из конф. файла)
+    int cache_write_time; //!< Время выполнения записи в кеш (считывается из конф. файла)
+};
+
+/*!
+  Получить ячейки памяти, хранящиеся в блоке кеша
+  \param c Указатель на структуру описания модели кеша
+  \param b Указатель на блок кеша
+  \return Ячейки блока (с value == NULL, если кеш не хранит данные)
+ */
+static inline MemoryCells
+set_cache_cells(const SetCache *c, const SetCacheBlock *b)
+{
+    return memory_cells_arena_at(c->data, c->block_count, c->block_size, b - c->blocks);
+}
+
+/*!
+  Получить тег (адрес блока ОЗУ) блока кеша
+  \param c Указатель на структуру описания модели кеша
+  \param b Указатель на блок кеша
+  \return Указатель на элемент массива тегов, соответствующий блоку
+ */
+static inline memaddr_t *
+set_cache_tag(const SetCache *c, const SetCacheBlock *b)
+{
+    return &c->tags[b - c->blocks];
+}
+
+/*!
+  Освободить ресурсы
+  \param m Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру)
+  \return Указатель NULL
+ */
+static AbstractMemory *
+set_cache_free(AbstractMemory *m)
+{
+    if (m) {
+        SetCache *c = (SetCache *) m;
+        if (c->mem) {
+            c->mem->ops->free(c->mem);
+        }
+        free(c->data);
+        free(c->tags);
+        free(c->blocks);
+        free(c);
+    }
+    return NULL;
+}
+
+/*!
+  Найти набор, в котором может находиться блок ОЗУ
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param aligned_addr Адрес начала блока
+  \return Указатель на первый блок набора
+ */
+static inline SetCacheBlock *
+set_cache_set(SetCache *c, memaddr_t aligned_addr)
+{
+    int index = (aligned_addr / c->block_size) % c->set_count;
+    return &c->blocks[index * c->ways];
+}
+
+/*!
+  Искать блок ОЗУ в множественно-ассоциативном кеше
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Указатель на соответствующий блок кеша, если таковой есть, и NULL в противном случае
+ */
+static SetCacheBlock *
+set_cache_find(SetCache *c, memaddr_t aligned_addr)
+{
+    SetCacheBlock *set = set_cache_set(c, aligned_addr);
+    const memaddr_t *tags = set_cache_tag(c, set);
+    for (int i = 0; i < c->ways; i++) {
+        if (tags[i] == aligned_addr) {
+            return &set[i];
+        }
+    }
+    return NULL;
+}
+
+/*!
+  Загрузить блок из нижележащей памяти, учитывая затраченные на это такты
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param b Указатель на блок кеша с уже установленным тегом
+ */
+static inline void
+set_cache_load(SetCache *c, SetCacheBlock *b)
+{
+    long long start = statistics_clock(c->b.info);
+    c->mem->ops->read(c->mem, *set_cache_tag(c, b), c->block_size, set_cache_cells(c, b));
+    statistics_add_fill_clock(c->b.info, statistics_clock(c->b.info) - start);
+}
+
+/*!
+  Записать ячейки в нижележащую память при сквозной записи, учитывая затраченные на это такты
+ */
+static inline void
+set_cache_write_through(SetCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    long long start = statistics_clock(c->b.info);
+    c->mem->ops->write(c->mem, addr, size, src);
+    statistics_add_write_through_clock(c->b.info, statistics_clock(c->b.info) - start);
+}
+
+/*!
+  Поместить блок ОЗУ в множественно-ассоциативный кеш
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Указатель на соответствующий блок кеша
+ */
+static SetCacheBlock *
+set_cache_random_place(SetCache *c, memaddr_t aligned_addr)
+{  
+    SetCacheBlock *set = set_cache_set(c, aligned_addr);
+    const memaddr_t *tags = set_cache_tag(c, set);
+    SetCacheBlock *b = NULL;
+    for (int i = 0; i < c->ways; i++) {
+        if (tags[i] == NO_BLOCK) {
+            b = &set[i];
+            break;
+        }
+    }
+    if (!b) {
+        int random_index = c->rnd->ops->next(c->rnd, c->ways);
+        b = &set[random_index];
+        statistics_add_eviction_counter(c->b.info);
+        c->set_ops.finalize(c, b);
+    }
+    *set_cache_tag(c, b) = aligned_addr;
+    set_cache_load(c, b);
+    return b;
+}
+
+/*!
+  Учет обращения к блоку при случайном замещении (ничего не делает)
+ */
+static void
+set_cache_random_touch(SetCache *c, SetCacheBlock *b)
+{
+    return;
+}
+
+/*!
+  Поместить блок ОЗУ в множественно-ассоциативный кеш, вытесняя при необходимости
+  дольше всех не использовавшийся блок набора
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Указатель на соответствующий блок кеша
+ */
+static SetCacheBlock *
+set_cache_lru_place(SetCache *c, memaddr_t aligned_addr)
+{
+    SetCacheBlock *set = set_cache_set(c, aligned_addr);
+    const memaddr_t *tags = set_cache_tag(c, set);
+    int n = 0;
+    for (int i = 0; i < c->ways && tags[n] != NO_BLOCK; i++) {
+        if (tags[i] == NO_BLOCK || set[i].stamp < set[n].stamp) {
+            n = i;
+        }
+    }
+    SetCacheBlock *b = &set[n];
+    if (tags[n] != NO_BLOCK) {
+        statistics_add_eviction_counter(c->b.info);
+        c->set_ops.finalize(c, b);
+    }
+    *set_cache_tag(c, b) = aligned_addr;
+    b->stamp = ++c->clock;
+    set_cache_load(c, b);
+    return b;
+}
+
+/*!
+  Учет обращения к блоку при замещении LRU: блоку присваивается новая метка времени
+ */
+static void
+set_cache_lru_touch(SetCache *c, SetCacheBlock *b)
+{
+    b->stamp = ++c->clock;
+}
+
+/*!
+  Учесть очередное обращение для старения LFU. Старение выполняется лениво:
+  меняется только номер эпохи, счетчики блоков пересчитываются при сравнении (см. lfu_count).
+ */
+static inline void
+set_cache_lfu_tick(SetCache *c)
+{
+    if (++c->lfu_refs == c->lfu.aging_interval) {
+        c->lfu_refs = 0;
+        c->lfu_epoch++;
+    }
+}
+
+/*!
+  Сравнить два занятых блока по порядку вытеснения LFU
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \return Ненулевое значение, если блок a должен быть вытеснен раньше блока b
+ */
+static int
+set_cache_lfu_less(const SetCache *c, const SetCacheBlock *a, const SetCacheBlock *b)
+{
+    int count_a = lfu_count(&c->lfu, a->lfu_count, a->lfu_epoch, c->lfu_epoch);
+    int count_b = lfu_count(&c->lfu, b->lfu_count, b->lfu_epoch, c->lfu_epoch);
+    if (count_a != count_b) {
+        return count_a < count_b;
+    }
+    // при равенстве сравниваются счетчики в эпоху более позднего обращения:
+    unsigned long long epoch = (a->lfu_epoch > b->lfu_epoch) ? a->lfu_epoch : b->lfu_epoch;
+    count_a = lfu_count(&c->lfu, a->lfu_count, a->lfu_epoch, epoch);
+    count_b = lfu_count(&c->lfu, b->lfu_count, b->lfu_epoch, epoch);
+    if (count_a != count_b) {
+        return count_a < count_b;
+    }
+    return a->stamp < b->stamp;
+}
+
+/*!
+  Поместить блок ОЗУ в множественно-ассоциативный кеш, вытесняя при необходимости
+  блок набора с наименьшим счетчиком LFU
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param aligned_addr Адрес начала искомого блока
+  \return Указатель на соответствующий блок кеша
+ */
+static SetCacheBlock *
+set_cache_lfu_place(SetCache *c, memaddr_t aligned_addr)
+{
+    set_cache_lfu_tick(c);
+    SetCacheBlock *set = set_cache_set(c, aligned_addr);
+    const memaddr_t *tags = set_cache_tag(c, set);
+    int n = 0;
+    for (int i = 0; i < c->ways && tags[n] != NO_BLOCK; i++) {
+        if (tags[i] == NO_BLOCK || set_cache_lfu_less(c, &set[i], &set[n])) {
+            n = i;
+        }
+    }
+    SetCacheBlock *b = &set[n];
+    if (tags[n] != NO_BLOCK) {
+        statistics_add_eviction_counter(c->b.info);
+        c->set_ops.finalize(c, b);
+    }
+    *set_cache_tag(c, b) = aligned_addr;
+    b->stamp = ++c->clock;
+    b->lfu_count = c->lfu.init_value;
+    b->lfu_epoch = c->lfu_epoch;
+    set_cache_load(c, b);
+    return b;
+}
+
+/*!
+  Учет обращения к блоку при замещении LFU: счетчик увеличивается с насыщением
+ */
+static void
+set_cache_lfu_touch(SetCache *c, SetCacheBlock *b)
+{
+    set_cache_lfu_tick(c);
+    b->lfu_count = lfu_increment(&c->lfu,
+        lfu_count(&c->lfu, b->lfu_count, b->lfu_epoch, c->lfu_epoch));
+    b->lfu_epoch = c->lfu_epoch;
+    b->stamp = ++c->clock;
+}
+
+/*!
+  Найти блок множественно-ассоциативного кеша, содержащий адрес, при промахе поместить блок в кеш
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  \param aligned_addr Адрес начала блока
+  \param p_hit Сюда записывается 1 в случае попадания и 0 в случае промаха
+  \return Указатель на блок кеша, содержащий адрес aligned_addr
+ */
+static inline SetCacheBlock *
+set_cache_fetch(SetCache *c, memaddr_t aligned_addr, int *p_hit)
+{
+    SetCacheBlock *b = set_cache_find(c, aligned_addr);
+    *p_hit = (b != NULL);
+    if (b) {
+        c->set_ops.touch(c, b);
+    } else {
+        b = c->set_ops.cache_place(c, aligned_addr);
+    }
+    return b;
+}
+
+/*!
+  Поместить прочитанное содержимое ячеек в блок кеша и "раскрыть" его в нижележащей памяти
+  (если кеш хранит данные)
+ */
+static inline void
+set_cache_reveal_block(SetCache *c, SetCacheBlock *b, memaddr_t addr, int size, MemoryCells src)
+{
+    if (c->data) {
+        memory_cells_copy(memory_cells_at(set_cache_cells(c, b), addr - *set_cache_tag(c, b)), src, size);
+        c->mem->ops->reveal(c->mem, addr, size, src);
+    }
+}
+
+/*!
+  Прочитать ячейки из множественно-ассоциативного кеша
+  \param m Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру)
+  \param addr Адрес в множественно-ассоциативном кеше
+  \param size Количество считываемых ячеек
+  \param dst Указатель, куда копировать ячейки из множественно-ассоциативного кеша
+ */
+static void
+set_cache_read(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells dst)
+{
+    SetCache *c = (SetCache*) m;
+    memaddr_t aligned_addr = addr & -c->block_size;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    SetCacheBlock *b = set_cache_fetch(c, aligned_addr, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    if (dst.value) {
+		// выполняем копирование данных:
+		memory_cells_copy(dst, memory_cells_at(set_cache_cells(c, b), addr - aligned_addr), size);
+	}
+}
+
+/*!
+  Прочитать ячейки из множественно-ассоциативного кеша и "раскрыть" их содержимое
+  (то же, что read и reveal, но с одним поиском блока в кеше)
+  \param m Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру)
+  \param addr Адрес в множественно-ассоциативном кеше
+  \param size Количество считываемых ячеек
+  \param src Прочитанное содержимое ячеек
+ */
+static void
+set_cache_read_reveal(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells src)
+{
+    SetCache *c = (SetCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    SetCacheBlock *b = set_cache_fetch(c, addr & -c->block_size, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    set_cache_reveal_block(c, b, addr, size, src);
+}
+
+/*!
+  Выполнить пачку шагов чтения (см. read_batch), накапливая статистику в локальных переменных
+ */
+static void
+set_cache_read_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    SetCache *c = (SetCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        int hit;
+        SetCacheBlock *b = set_cache_fetch(c, steps[i].addr & -c->block_size, &hit);
+        hits += hit;
+        set_cache_reveal_block(c, b, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_reads(c->b.info, count, (long long) count * c->cache_read_time);
+    statistics_add_hit_counters(c->b.info, hits, (long long) hits * c->cache_read_time);
+}
+
+/*!
+  Записать ячейки в кеш со сквозной записью, не учитывая время записи в кеш
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline int
+set_cache_wt_store(SetCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    memaddr_t aligned_addr = addr & -c->block_size;
+    SetCacheBlock *b = set_cache_find(c, aligned_addr);
+    if (b) {
+        c->set_ops.touch(c, b);
+        if (c->data) {
+            memory_cells_copy(memory_cells_at(set_cache_cells(c, b), addr - aligned_addr), src, size);
+        }
+    }
+    set_cache_write_through(c, addr, size, src);
+    return b != NULL;
+}
+
+/*!
+  Функция записи в кеш в случае сквозной записи
+  \param m Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру)
+  \param addr Адрес в множественно-ассоциативном кеше
+  \param size Количество записываемых ячеек
+  \param src Указатель, откуда копировать ячейки в множественно-ассоциативного кеша
+*/
+static void
+set_cache_wt_write(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells src)
+{
+    SetCache *c = (SetCache*) m;
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (set_cache_wt_store(c, addr, size, src)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
+    }
+}
+
+/*!
+  Выполнить пачку шагов записи в кеш со сквозной записью (см. write_batch)
+ */
+static void
+set_cache_wt_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    SetCache *c = (SetCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += set_cache_wt_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
+}
+
+/*!
+  Записать ячейки в кеш с отложенной записью, не учитывая время записи в кеш
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline int
+set_cache_wb_store(SetCache *c, memaddr_t addr, int size, MemoryCells src)
+{
+    memaddr_t aligned_addr = addr & -c->block_size;
+    SetCacheBlock *b = set_cache_find(c, aligned_addr);
+    int hit = (b != NULL);
+    if (b) {
+        c->set_ops.touch(c, b);
+    } else {
+        b = c->set_ops.cache_place(c, aligned_addr);
+    }
+    if (c->data) {
+        memory_cells_copy(memory_cells_at(set_cache_cells(c, b), addr - aligned_addr), src, size);
+    }
+    b->dirty = 1;
+    return hit;
+}
+
+/*!
+  Функция записи в кеш в случае отложенной записи
+  \param m Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру)
+  \param addr Адрес в множественно-ассоциативном кеше
+  \param size Количество записываемых ячеек
+  \param src Указатель, откуда копировать ячейки в множественно-ассоциативного кеша
+*/
+static void
+set_cache_wb_write(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells src)
+{
+    SetCache *c = (SetCache*) m;
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (set_cache_wb_store(c, addr, size, src)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
+    }
+}
+
+/*!
+  Выполнить пачку шагов записи в кеш с отложенной записью (см. write_batch)
+ */
+static void
+set_cache_wb_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    SetCache *c = (SetCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += set_cache_wb_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
+}
+
+/*!
+  "Раскрыть" содержимое указанных ячеек ОЗУ (а, значит, и кеша, если эти ячейки там есть).
+  \param m Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру)
+  \param addr Адрес в множественно-ассоциативном кеше
+  \param size Количество считываемых ячеек
+  \param src Указатель, откуда копировать ячейки в множественно-ассоциативного кеша
+ */
+static void
+set_cache_reveal(
+    AbstractMemory *m,
+    memaddr_t addr,
+    int size,
+    MemoryCells src)
+{
+    SetCache *c = (SetCache*) m;
+    memaddr_t aligned_addr = addr & -c->block_size;
+    SetCacheBlock *b = set_cache_find(c, aligned_addr);
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(set_cache_cells(c, b), addr - aligned_addr), src, size);
+    }
+    c->mem->ops->reveal(c->mem, addr, size, src);
+}
+
+/*!
+  Финализация блока кеша в случае сквозной записи (см. описание SetCacheOps->finalize)
+*/
+static void
+set_cache_wt_finalize(SetCache *c, SetCacheBlock *b)
+{
+    return;
+}
+
+/*!
+  Финализация блока кеша в случае отложенной записи записи (см. описание SetCacheOps->finalize)
+*/
+static void
+set_cache_wb_finalize(SetCache *c, SetCacheBlock *b)
+{
+    if (b->dirty) {
+        long long start = statistics_clock(c->b.info);
+        statistics_add_write_back_counter(c->b.info);
+        c->mem->ops->write(c->mem, *set_cache_tag(c, b), c->block_size, set_cache_cells(c, b));
+        statistics_add_write_back_clock(c->b.info, statistics_clock(c->b.info) - start);
+        b->dirty = 0;
+    }
+}
+
+/*!
+    Фиксировать состояние памяти - кеш сбрасывает из кеша все грязные блоки
+    (для кеша со сквозной записью такие блоки отсутствуют)
+    \param m Указатель на структуру описания модели кеша (в виде указателя на базовую структуру)
+*/
+static void
+set_cache_flush(AbstractMemory *m)
+{
+    SetCache *c = (SetCache*) m;
+    for (int i = 0; i < c->block_count; i++) {
+        if (c->tags[i] != NO_BLOCK) {
+            c->set_ops.finalize(c, &c->blocks[i]);
+        }
+    }
+    c->mem->ops->flush(c->mem);
+}
+
+/*!
+    Печатает содержимое нижележащей памяти.
+    \param m Указатель на структуру описания модели памяти
+    \param out_f Файл, куда печатается содержимое памяти
+*/
+void
+set_cache_print_dump(AbstractMemory *m, FILE *f_out)
+{
+	SetCache *c = (SetCache*) m;
+	c->mem->ops->print_dump(c->mem, f_out);
+}
+
+static AbstractMemoryOps set_cache_wt_ops =
+{
+    set_cache_free,
+    set_cache_read,
+    set_cache_wt_write,
+    set_cache_reveal,
+    set_cache_read_reveal,
+    set_cache_read_batch,
+    set_cache_wt_write_batch,
+    set_cache_flush,
+    set_cache_print_dump
+};
+
+static AbstractMemoryOps set_cache_wb_ops =
+{
+    set_cache_free,
+    set_cache_read,
+    set_cache_wb_write,
+    set_cache_reveal,
+    set_cache_read_reveal,
+    set_cache_read_batch,
+    set_cache_wb_write_batch,
+    set_cache_flush,
+    set_cache_print_dump
+};
+
+/*
+  Специализированные ядра одиночных и пакетных операций. Размер блока и число блоков в наборе
+  в них - константы, поэтому номер набора вычисляется сдвигом и маской, а цикл поиска по набору
+  разворачивается компилятором. Одиночные операции нужны кешам нижних уровней и раздельным кешам,
+  которые получают обращения по одному. Ядра применимы, если число наборов - степень двойки;
+  в остальных случаях используются общие операции set_cache_wt_ops и set_cache_wb_ops.
+ */
+
+/*!
+  Искать блок ОЗУ в кеше (см. set_cache_find)
+  \param block_shift Логарифм размера блока
+  \param ways Число блоков в наборе
+ */
+static inline __attribute__((always_inline)) SetCacheBlock *
+set_cache_kernel_find(SetCache *c, memaddr_t aligned_addr, int block_shift, int ways)
+{
+    int first = ((aligned_addr >> block_shift) & c->set_mask) * ways;
+    const memaddr_t *tags = &c->tags[first];
+    for (int i = 0; i < ways; i++) {
+        if (tags[i] == aligned_addr) {
+            return &c->blocks[first + i];
+        }
+    }
+    return NULL;
+}
+
+/*!
+  Найти блок, содержащий адрес, при промахе поместить блок в кеш (см. set_cache_fetch)
+ */
+static inline __attribute__((always_inline)) SetCacheBlock *
+set_cache_kernel_fetch(SetCache *c, memaddr_t addr, int block_shift, int ways, int *p_hit)
+{
+    memaddr_t aligned_addr = addr & -(1 << block_shift);
+    SetCacheBlock *b = set_cache_kernel_find(c, aligned_addr, block_shift, ways);
+    *p_hit = (b != NULL);
+    if (b) {
+        c->set_ops.touch(c, b);
+    } else {
+        b = c->set_ops.cache_place(c, aligned_addr);
+    }
+    return b;
+}
+
+/*!
+  Записать ячейки в кеш, не учитывая время записи в кеш (см. set_cache_wt_store и set_cache_wb_store)
+  \param write_back Ненулевое значение для кеша с отложенной записью
+  \return 1 в случае попадания, 0 в случае промаха
+ */
+static inline __attribute__((always_inline)) int
+set_cache_kernel_store(SetCache *c, memaddr_t addr, int size, MemoryCells src, int block_shift, int ways, int write_back)
+{
+    memaddr_t aligned_addr = addr & -(1 << block_shift);
+    SetCacheBlock *b = set_cache_kernel_find(c, aligned_addr, block_shift, ways);
+    int hit = (b != NULL);
+    if (b) {
+        c->set_ops.touch(c, b);
+    } else if (write_back) {
+        b = c->set_ops.cache_place(c, aligned_addr);
+    }
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(set_cache_cells(c, b), addr - aligned_addr), src, size);
+    }
+    if (write_back) {
+        b->dirty = 1;
+    } else {
+        set_cache_write_through(c, addr, size, src);
+    }
+    return hit;
+}
+
+/*!
+  Ядро чтения (см. set_cache_read)
+ */
+static inline __attribute__((always_inline)) void
+set_cache_kernel_read(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst, int block_shift, int ways)
+{
+    SetCache *c = (SetCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    SetCacheBlock *b = set_cache_kernel_fetch(c, addr, block_shift, ways, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    if (dst.value) {
+        memory_cells_copy(dst, memory_cells_at(set_cache_cells(c, b), addr - *set_cache_tag(c, b)), size);
+    }
+}
+
+/*!
+  Ядро чтения с "раскрытием" (см. set_cache_read_reveal)
+ */
+static inline __attribute__((always_inline)) void
+set_cache_kernel_read_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src, int block_shift, int ways)
+{
+    SetCache *c = (SetCache*) m;
+    int hit;
+    statistics_add_cache_read(c->b.info, c->cache_read_time);
+    SetCacheBlock *b = set_cache_kernel_fetch(c, addr, block_shift, ways, &hit);
+    if (hit) {
+        statistics_add_hit_counter(c->b.info, c->cache_read_time);
+    }
+    set_cache_reveal_block(c, b, addr, size, src);
+}
+
+/*!
+  Ядро записи (см. set_cache_wt_write и set_cache_wb_write)
+ */
+static inline __attribute__((always_inline)) void
+set_cache_kernel_write(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src, int block_shift, int ways, int write_back)
+{
+    SetCache *c = (SetCache*) m;
+    statistics_add_cache_write(c->b.info, c->cache_write_time);
+    if (set_cache_kernel_store(c, addr, size, src, block_shift, ways, write_back)) {
+        statistics_add_write_hit_counter(c->b.info, c->cache_write_time);
+    }
+}
+
+/*!
+  Ядро "раскрытия" (см. set_cache_reveal)
+ */
+static inline __attribute__((always_inline)) void
+set_cache_kernel_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src, int block_shift, int ways)
+{
+    SetCache *c = (SetCache*) m;
+    memaddr_t aligned_addr = addr & -(1 << block_shift);
+    SetCacheBlock *b = set_cache_kernel_find(c, aligned_addr, block_shift, ways);
+    if (b && c->data) {
+        memory_cells_copy(memory_cells_at(set_cache_cells(c, b), addr - aligned_addr), src, size);
+    }
+    c->mem->ops->reveal(c->mem, addr, size, src);
+}
+
+/*!
+  Ядро пакетного чтения (см. set_cache_read_batch)
+ */
+static inline __attribute__((always_inline)) void
+set_cache_kernel_read_batch(AbstractMemory *m, const TraceStep *steps, int count, int block_shift, int ways)
+{
+    SetCache *c = (SetCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        int hit;
+        SetCacheBlock *b = set_cache_kernel_fetch(c, steps[i].addr, block_shift, ways, &hit);
+        hits += hit;
+        set_cache_reveal_block(c, b, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+    statistics_add_cache_reads(c->b.info, count, (long long) count * c->cache_read_time);
+    statistics_add_hit_counters(c->b.info, hits, (long long) hits * c->cache_read_time);
+}
+
+/*!
+  Ядро пакетной записи (см. set_cache_wt_write_batch и set_cache_wb_write_batch)
+  \param write_back Ненулевое значение для кеша с отложенной записью
+ */
+static inline __attribute__((always_inline)) void
+set_cache_kernel_write_batch(AbstractMemory *m, const TraceStep *steps, int count, int block_shift, int ways, int write_back)
+{
+    SetCache *c = (SetCache*) m;
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        hits += set_cache_kernel_store(c, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]),
+            block_shift, ways, write_back);
+    }
+    statistics_add_cache_writes(c->b.info, count, (long long) count * c->cache_write_time);
+    statistics_add_write_hit_counters(c->b.info, hits, (long long) hits * c->cache_write_time);
+}
+
+/*!
+  Определить одиночные и пакетные операции и таблицы операций для заданных размера блока и числа блоков в наборе
+ */
+#define SET_CACHE_KERNELS(BLOCK_SIZE, BLOCK_SHIFT, WAYS)                                  \
+static void                                                                               \
+set_cache_read_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst) \
+{                                                                                         \
+    set_cache_kernel_read(m, addr, size, dst, BLOCK_SHIFT, WAYS);                         \
+}                                                                                         \
+static void                                                                               \
+set_cache_read_reveal_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    set_cache_kernel_read_reveal(m, addr, size, src, BLOCK_SHIFT, WAYS);                  \
+}                                                                                         \
+static void                                                                               \
+set_cache_reveal_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    set_cache_kernel_reveal(m, addr, size, src, BLOCK_SHIFT, WAYS);                       \
+}                                                                                         \
+static void                                                                               \
+set_cache_wt_write_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    set_cache_kernel_write(m, addr, size, src, BLOCK_SHIFT, WAYS, 0);                     \
+}                                                                                         \
+static void                                                                               \
+set_cache_wb_write_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src) \
+{                                                                                         \
+    set_cache_kernel_write(m, addr, size, src, BLOCK_SHIFT, WAYS, 1);                     \
+}                                                                                         \
+static void                                                                               \
+set_cache_read_batch_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    set_cache_kernel_read_batch(m, steps, count, BLOCK_SHIFT, WAYS);                      \
+}                                                                                         \
+static void                                                                               \
+set_cache_wt_write_batch_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    set_cache_kernel_write_batch(m, steps, count, BLOCK_SHIFT, WAYS, 0);                  \
+}                                                                                         \
+static void                                                                               \
+set_cache_wb_write_batch_##BLOCK_SIZE##_##WAYS(AbstractMemory *m, const TraceStep *steps, int count) \
+{                                                                                         \
+    set_cache_kernel_write_batch(m, steps, count, BLOCK_SHIFT, WAYS, 1);                  \
+}                                                                                         \
+static AbstractMemoryOps set_cache_wt_ops_##BLOCK_SIZE##_##WAYS =                         \
+{                                                                                         \
+    set_cache_free,                                                                       \
+    set_cache_read_##BLOCK_SIZE##_##WAYS,                                                 \
+    set_cache_wt_write_##BLOCK_SIZE##_##WAYS,                                             \
+    set_cache_reveal_##BLOCK_SIZE##_##WAYS,                                               \
+    set_cache_read_reveal_##BLOCK_SIZE##_##WAYS,                                          \
+    set_cache_read_batch_##BLOCK_SIZE##_##WAYS,                                           \
+    set_cache_wt_write_batch_##BLOCK_SIZE##_##WAYS,                                       \
+    set_cache_flush,                                                                      \
+    set_cache_print_dump                                                                  \
+};                                                                                        \
+static AbstractMemoryOps set_cache_wb_ops_##BLOCK_SIZE##_##WAYS =                         \
+{                                                                                         \
+    set_cache_free,                                                                       \
+    set_cache_read_##BLOCK_SIZE##_##WAYS,                                                 \
+    set_cache_wb_write_##BLOCK_SIZE##_##WAYS,                                             \
+    set_cache_reveal_##BLOCK_SIZE##_##WAYS,                                               \
+    set_cache_read_reveal_##BLOCK_SIZE##_##WAYS,                                          \
+    set_cache_read_batch_##BLOCK_SIZE##_##WAYS,                                           \
+    set_cache_wb_write_batch_##BLOCK_SIZE##_##WAYS,                                       \
+    set_cache_flush,                                                                      \
+    set_cache_print_dump                                                                  \
+};
+
+SET_CACHE_KERNELS(16, 4, 2)
+SET_CACHE_KERNELS(16, 4, 4)
+SET_CACHE_KERNELS(16, 4, 8)
+SET_CACHE_KERNELS(16, 4, 16)
+SET_CACHE_KERNELS(32, 5, 2)
+SET_CACHE_KERNELS(32, 5, 4)
+SET_CACHE_KERNELS(32, 5, 8)
+SET_CACHE_KERNELS(32, 5, 16)
+SET_CACHE_KERNELS(64, 6, 2)
+SET_CACHE_KERNELS(64, 6, 4)
+SET_CACHE_KERNELS(64, 6, 8)
+SET_CACHE_KERNELS(64, 6, 16)
+
+/*!
+  Таблицы операций со специализированными ядрами:
+  [размер блока 16, 32, 64][число блоков в наборе 2, 4, 8, 16][сквозная, отложенная запись]
+ */
+static AbstractMemoryOps *const set_cache_kernel_table[3][4][2] =
+{
+    {
+        { &set_cache_wt_ops_16_2, &set_cache_wb_ops_16_2 },
+        { &set_cache_wt_ops_16_4, &set_cache_wb_ops_16_4 },
+        { &set_cache_wt_ops_16_8, &set_cache_wb_ops_16_8 },
+        { &set_cache_wt_ops_16_16, &set_cache_wb_ops_16_16 }
+    },
+    {
+        { &set_cache_wt_ops_32_2, &set_cache_wb_ops_32_2 },
+        { &set_cache_wt_ops_32_4, &set_cache_wb_ops_32_4 },
+        { &set_cache_wt_ops_32_8, &set_cache_wb_ops_32_8 },
+        { &set_cache_wt_ops_32_16, &set_cache_wb_ops_32_16 }
+    },
+    {
+        { &set_cache_wt_ops_64_2, &set_cache_wb_ops_64_2 },
+        { &set_cache_wt_ops_64_4, &set_cache_wb_ops_64_4 },
+        { &set_cache_wt_ops_64_8, &set_cache_wb_ops_64_8 },
+        { &set_cache_wt_ops_64_16, &set_cache_wb_ops_64_16 }
+    }
+};
+
+/*!
+  Логарифм степени двойки value в диапазоне [1 << low, 1 << high], -1 - если value не такова
+ */
+static inline int
+set_cache_log2(int value, int low, int high)
+{
+    for (int i = low; i <= high; i++) {
+        if (value == 1 << i) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*!
+  Выбрать таблицу операций со специализированными ядрами
+  \param c Указатель на структуру описания модели множественно-ассоциативного кеша
+  (геометрия и стратегия записи уже заданы)
+  \return Указатель на таблицу операций, NULL - если специализированного ядра нет
+ */
+static AbstractMemoryOps *
+set_cache_kernel_ops(const SetCache *c)
+{
+    int write_back = (c->b.ops == &set_cache_wb_ops);
+    int block_shift = set_cache_log2(c->block_size, 4, 6);
+    int ways_shift = set_cache_log2(c->ways, 1, 4);
+    if (block_shift < 0 || ways_shift < 0 || (c->set_count & (c->set_count - 1))) {
+        return NULL;
+    }
+    return set_cache_kernel_table[block_shift - 4][ways_shift - 1][write_back];
+}
+
+static inline int
+is_correct_block_size(int block_size)
+{
+    return (block_size == 16) || (block_size == 32) || (block_size == 64);
+}
+
+/*!
+  Создать модель множественно-ассоциативного кеша
+  \param cfg Указатель на структуру, хранящую конфигурационные параметры
+  \param var_prefix Префикс имен параметров
+  \param info Указатель на структуру, хранящую статистику моделирования
+  \return Указатель на структуру описания модели множественно-ассоциативного кеша (в виде указателя на базовую структуру),
+  NULL в случае ошибки
+ */
+AbstractMemory *
+set_cache_create(
+    ConfigFile *cfg,
+    const char *var_prefix,
+    StatisticsInfo *info,
+    AbstractMemory *mem,
+    Random *rnd,
+    int tag_only)
+{
+    char buf[PARAM_BUF_SIZE];
+    SetCache *c = (SetCache*) calloc(1, sizeof(*c));
+    c->b.info = info;
+    c->rnd = rnd;
+    c->mem = mem;
+    c->blocks = NULL;
+    c->block_count = 0;
+    
+    //определяем стратегию записи и соответственно задаём операции:
+    const char fn[] = "set_cache_create";
+    const char *strategy = config_file_get(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "write_strategy"));
+    if (!strategy) {
+        error_undefined(fn, buf);
+        goto set_cache_create_failed;
+    } else if (strcmp(strategy, "write-through") == 0) {
+        c->b.ops = &set_cache_wt_ops;
+        c->set_ops.finalize = set_cache_wt_finalize;
+    } else if (strcmp(strategy, "write-back") == 0) {
+        c->b.ops = &set_cache_wb_ops;
+        c->set_ops.finalize = set_cache_wb_finalize;
+        c->b.info->write_back_needed = 1;
+    } else {
+        error_invalid(fn, buf);
+        goto set_cache_create_failed;
+    }
+    
+    //определяем стратегию замещения и соответственно задаём функцию размещения:
+    strategy = config_file_get(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "replacement_strategy"));
+    if (!strategy) {
+        error_undefined(fn, buf);
+        goto set_cache_create_failed;
+    } else if (strcmp(strategy, "random") == 0) {
+        c->set_ops.cache_place = set_cache_random_place;
+        c->set_ops.touch = set_cache_random_touch;
+    } else if (strcmp(strategy, "lru") == 0) {
+        c->set_ops.cache_place = set_cache_lru_place;
+        c->set_ops.touch = set_cache_lru_touch;
+    } else if (strcmp(strategy, "lfu") == 0) {
+        c->set_ops.cache_place = set_cache_lfu_place;
+        c->set_ops.touch = set_cache_lfu_touch;
+        if (lfu_config_read(&c->lfu, cfg, var_prefix, fn) < 0) {
+            goto set_cache_create_failed;
+        }
+    } else {
+        error_invalid(fn, buf);
+        goto set_cache_create_failed;
+    }
+
+    // считываем и проверяем параметр associativity (число блоков в наборе):
+    int r = config_file_get_int(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "associativity"),
+        &c->ways);
+    if (!r) {
+        error_undefined(fn, buf);
+        goto set_cache_create_failed;
+    } else if (r < 0 || c->ways <= 0) {
+        error_invalid(fn, buf);
+        goto set_cache_create_failed;
+    }
+    // считываем и проверяем параметр block_size:
+    r = config_file_get_int(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "block_size"),
+        &c->block_size);
+    if (!r) {
+		error_undefined(fn, buf);
+		goto set_cache_create_failed;
+	} else if (r < 0 || !is_correct_block_size(c->block_size)) {
+		error_invalid(fn, buf);
+		goto set_cache_create_failed;
+    }
+    // считываем и проверяем параметр cache_size:
+    r = config_file_get_int(cfg,
+		make_param_name(buf, sizeof(buf), var_prefix, "cache_size"),
+		&c->cache_size);
+	if (!r) {
+		error_undefined(fn, buf);
+		goto set_cache_create_failed;
+	} else if (r < 0 || c->cache_size <= 0
+        || c->cache_size > MAX_CACHE_SIZE
+        || c->cache_size % c->block_size != 0)
+    {
+		error_invalid(fn, buf);
+		goto set_cache_create_failed;
+	}
+    // блоки кеша должны делиться на наборы поровну:
+    if (c->cache_size / c->block_size % c->ways != 0) {
+        error_invalid(fn, make_param_name(buf, sizeof(buf), var_prefix, "associativity"));
+        goto set_cache_create_failed;
+    }
+    // считываем и проверяем параметр cache_read_time:
+    r = config_file_get_int(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "cache_read_time"),
+        &c->cache_read_time);
+    if (!r) {
+		error_undefined(fn, buf);
+		goto set_cache_create_failed;
+	} else if (r < 0 || c->cache_read_time <= 0
+        || c->cache_read_time > MAX_READ_TIME)
+    {
+		error_invalid(fn, buf);
+		goto set_cache_create_failed;
+    }
+    // считываем и проверяем параметр cache_write_time:
+    r = config_file_get_int(cfg,
+        make_param_name(buf, sizeof(buf), var_prefix, "cache_write_time"),
+        &c->cache_write_time);
+    if (!r) {
+		error_undefined(fn, buf);
+		goto set_cache_create_failed;
+	} else if (r < 0 || c->cache_write_time <= 0
+        || c->cache_write_time > MAX_WRITE_TIME)
+    {
+		error_invalid(fn, buf);
+		goto set_cache_create_failed;
+    }
+    
+    //выделяем блоки кэша:
+    c->block_count = c->cache_size / c->block_size;
+    c->set_count = c->block_count / c->ways;
+    if (!tag_only) {
+        c->data = memory_cells_arena_create(c->block_count, c->block_size);
+        // без области данных кеш не хранил бы значения и терял бы их по пути в ОЗУ:
+        if (!c->data) {
+            fprintf(stderr, "set_cache_create: out of memory\n");
+            goto set_cache_create_failed;
+        }
+    }
+    c->blocks = calloc(c->block_count, sizeof(*c->blocks));
+    c->tags = calloc(c->block_count, sizeof(*c->tags));
+    for (int i = 0; i < c->block_count; i++) {
+        c->tags[i] = NO_BLOCK;
+    }
+    // при подходящей геометрии пакетные операции выполняются специализированными ядрами:
+    c->set_mask = c->set_count - 1;
+    AbstractMemoryOps *kernel_ops = set_cache_kernel_ops(c);
+    if (kernel_ops) {
+        c->b.ops = kernel_ops;
+    }
+
+    return (AbstractMemory*) c;
+set_cache_create_failed:
+    return set_cache_free((AbstractMemory*) c);
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,35 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file set_cache.h
+  \brief Множественно-ассоциативный кеш
+ */
+
+#ifndef SET_CACHE_H_INCLUDED
+#define SET_CACHE_H_INCLUDED
+
+#include "abstract_memory.h"
+#include "parse_config.h"
+#include "random.h"
+
+/*!
+  Создать множественно-ассоциативный кеш. Эта функция вызывается из cache_create после определения типа кеша,
+  заданного в конфигурационном файле (число блоков в наборе задается параметром associativity).
+  \param cfg Указатель на структуру, хранящую конфигурационные параметры
+  \param var_prefix Префикс имен параметров
+  \param info Указатель на структуру, хранящую статистику моделирования
+  \param mem Указатель на дескриптор нижележащей памяти (в виде указателя на базовую структуру)
+  \param rnd Указатель на дескриптор генератора случайных чисел
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно: блоки кеша не хранят данные,
+  моделируются только теги и время доступа
+  \return Указатель на структуру описания модели кеша (в виде указателя на базовую структуру)
+ */
+AbstractMemory *set_cache_create(ConfigFile *cfg, const char *var_prefix, StatisticsInfo *info, AbstractMemory *mem, Random *rnd, int tag_only);
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
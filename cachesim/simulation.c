@@ -0,0 +1,90 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "simulation.h"
+#include "cache.h"
+#include "memory.h"
+
+#include <stdlib.h>
+
+Simulation *
+simulation_create(const char *path, int disable_cache, int tag_only, FILE *log_f)
+{
+    Simulation *s = calloc(1, sizeof(*s));
+    s->name = path;
+    s->cfg = config_file_parse(path, log_f);
+    if (!s->cfg) {
+        goto simulation_create_failed;
+    }
+    s->info = statistics_create(s->cfg);
+    s->mem = memory_create(s->cfg, NULL, s->info, tag_only);
+    if (!s->mem) {
+        goto simulation_create_failed;
+    }
+    s->imem = s->ram = s->mem;
+    if (!disable_cache) {
+        s->rnd = random_create(s->cfg);
+        if (!s->rnd) {
+            goto simulation_create_failed;
+        }
+        s->mem = cache_hierarchy_create(s->cfg, s->info, s->mem, s->rnd, tag_only, &s->imem);
+        if (!s->mem) {
+            goto simulation_create_failed;
+        }
+    }
+    // у ОЗУ свой дескриптор статистики; он создается после кешей, чтобы печататься последним:
+    s->ram->info = statistics_create_component(s->info, "memory");
+    return s;
+simulation_create_failed:
+    return simulation_free(s);
+}
+
+Simulation *
+simulation_free(Simulation *s)
+{
+    if (s) {
+        if (s->mem) {
+            s->mem->ops->free(s->mem);
+        }
+        if (s->rnd) {
+            s->rnd->ops->free(s->rnd);
+        }
+        statistics_free(s->info);
+        config_file_free(s->cfg);
+        free(s);
+    }
+    return NULL;
+}
+
+void
+simulation_run(Simulation *s, const TraceStep *steps, int count)
+{
+    int reads = 0, writes = 0;
+    for (int i = 0, j; i < count; i = j) {
+        // серия подряд идущих шагов с одной операцией к одной памяти выполняется одной пачкой:
+        int instr = (steps[i].mem == 'I');
+        for (j = i + 1; j < count && steps[j].op == steps[i].op && (steps[j].mem == 'I') == instr; j++) {
+        }
+        AbstractMemory *m = instr ? s->imem : s->mem;
+        if (steps[i].op == 'R') {
+            reads += j - i;
+            m->ops->read_batch(m, steps + i, j - i);
+        } else if (steps[i].op == 'W') {
+            writes += j - i;
+            m->ops->write_batch(m, steps + i, j - i);
+        }
+    }
+    statistics_add_reads(s->info, reads);
+    statistics_add_writes(s->info, writes);
+}
+
+void
+simulation_finish(Simulation *s)
+{
+    s->mem->ops->flush(s->mem);
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,74 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file simulation.h
+  \brief Модель вычислительной системы, построенная по одному конфигурационному файлу
+ */
+
+#ifndef SIMULATION_H_INCLUDED
+#define SIMULATION_H_INCLUDED
+
+#include "abstract_memory.h"
+#include "parse_config.h"
+#include "random.h"
+#include "statistics.h"
+#include "trace.h"
+
+#include <stdio.h>
+
+/*!
+  Модель объединяет память, иерархию кешей, генератор случайных чисел и статистику.
+  Модели не разделяют никакого состояния, поэтому разные модели можно выполнять в разных потоках.
+  \brief Дескриптор модели
+ */
+typedef struct Simulation
+{
+    const char *name; //!< Имя модели (путь к конфигурационному файлу)
+    ConfigFile *cfg; //!< Конфигурационные параметры
+    StatisticsInfo *info; //!< Статистика моделирования
+    Random *rnd; //!< Генератор случайных чисел, NULL - если кеш отключен
+    AbstractMemory *mem; //!< Память для обращений к данным (верхний уровень иерархии)
+    AbstractMemory *imem; //!< Память для обращений к командам
+    AbstractMemory *ram; //!< ОЗУ (нижний уровень иерархии, см. memory.h)
+} Simulation;
+
+/*!
+  Создать модель по конфигурационному файлу
+  \param path Путь к конфигурационному файлу (запоминается без копирования)
+  \param disable_cache Ненулевое значение, если моделируется только ОЗУ без кеша
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно (например, не печатается дамп):
+  данные не копируются, статистика при этом не меняется
+  \param log_f Файл для вывода сообщений об ошибках
+  \return Указатель на дескриптор модели, NULL в случае ошибки
+ */
+Simulation *simulation_create(const char *path, int disable_cache, int tag_only, FILE *log_f);
+
+/*!
+  Освободить ресурсы
+  \param s Указатель на дескриптор модели
+  \return NULL
+ */
+Simulation *simulation_free(Simulation *s);
+
+/*!
+  Выполнить операции над памятью, указанные в шагах трассы. Серии подряд идущих шагов
+  с одинаковой операцией к одной памяти передаются модели памяти пачками (read_batch, write_batch).
+  \param s Указатель на дескриптор модели
+  \param steps Массив шагов трассы
+  \param count Число шагов
+ */
+void simulation_run(Simulation *s, const TraceStep *steps, int count);
+
+/*!
+  Завершить моделирование: фиксировать состояние памяти (сбросить грязные блоки кешей)
+  \param s Указатель на дескриптор модели
+ */
+void simulation_finish(Simulation *s);
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
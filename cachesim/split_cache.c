@@ -0,0 +1,312 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "split_cache.h"
+#include "cache.h"
+
+#include <stdlib.h>
+
+/*!
+  Порт доступа к общей нижележащей памяти. Передает ей все операции, кроме освобождения:
+  общую память освобождает модель раздельных кешей.
+  \brief Порт общей нижележащей памяти
+ */
+typedef struct SplitPort
+{
+    AbstractMemory b; //!< Базовые поля
+    AbstractMemory *mem; //!< Общая нижележащая память
+} SplitPort;
+
+struct SplitCache;
+typedef struct SplitCache SplitCache;
+
+/*!
+  Одна сторона (команды или данные) раздельных кешей
+  \brief Сторона раздельных кешей
+ */
+typedef struct SplitSide
+{
+    AbstractMemory b; //!< Базовые поля
+    SplitCache *owner; //!< Модель раздельных кешей, которой принадлежит сторона
+    AbstractMemory *own; //!< Кеш этой стороны
+    AbstractMemory *other; //!< Кеш другой стороны
+} SplitSide;
+
+/*!
+  Раздельные кеши команд и данных
+  \brief Дескриптор раздельных кешей
+ */
+struct SplitCache
+{
+    SplitSide data; //!< Сторона данных (должна быть первым полем: ее адрес - адрес модели)
+    SplitSide instr; //!< Сторона команд
+    AbstractMemory *icache; //!< Кеш команд
+    AbstractMemory *dcache; //!< Кеш данных
+    AbstractMemory *mem; //!< Общая нижележащая память
+};
+
+/*!
+  Освободить порт (общая память не освобождается)
+ */
+static AbstractMemory *
+split_port_free(AbstractMemory *m)
+{
+    free(m);
+    return NULL;
+}
+
+static void
+split_port_read(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->read(p->mem, addr, size, dst);
+}
+
+static void
+split_port_write(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->write(p->mem, addr, size, src);
+}
+
+static void
+split_port_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->reveal(p->mem, addr, size, src);
+}
+
+static void
+split_port_read_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->read_reveal(p->mem, addr, size, src);
+}
+
+static void
+split_port_read_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->read_batch(p->mem, steps, count);
+}
+
+static void
+split_port_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->write_batch(p->mem, steps, count);
+}
+
+static void
+split_port_flush(AbstractMemory *m)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->flush(p->mem);
+}
+
+static void
+split_port_print_dump(AbstractMemory *m, FILE *f_out)
+{
+    SplitPort *p = (SplitPort*) m;
+    p->mem->ops->print_dump(p->mem, f_out);
+}
+
+static AbstractMemoryOps split_port_ops =
+{
+    split_port_free,
+    split_port_read,
+    split_port_write,
+    split_port_reveal,
+    split_port_read_reveal,
+    split_port_read_batch,
+    split_port_write_batch,
+    split_port_flush,
+    split_port_print_dump
+};
+
+/*!
+  Создать порт общей нижележащей памяти
+ */
+static AbstractMemory *
+split_port_create(AbstractMemory *mem)
+{
+    SplitPort *p = calloc(1, sizeof(*p));
+    p->b.ops = &split_port_ops;
+    p->b.info = mem->info;
+    p->mem = mem;
+    return (AbstractMemory*) p;
+}
+
+/*!
+  Освободить ресурсы: оба кеша и общую нижележащую память
+  \param m Указатель на сторону данных (в виде указателя на базовую структуру)
+  \return Указатель NULL
+ */
+static AbstractMemory *
+split_cache_free(AbstractMemory *m)
+{
+    if (m) {
+        SplitCache *c = (SplitCache*) m;
+        if (c->icache) {
+            c->icache->ops->free(c->icache);
+        }
+        if (c->dcache) {
+            c->dcache->ops->free(c->dcache);
+        }
+        if (c->mem) {
+            c->mem->ops->free(c->mem);
+        }
+        free(c);
+    }
+    return NULL;
+}
+
+/*!
+  Освобождение стороны команд (ничего не делает, см. split_cache_instruction_side)
+ */
+static AbstractMemory *
+split_side_free(AbstractMemory *m)
+{
+    return NULL;
+}
+
+static void
+split_side_read(AbstractMemory *m, memaddr_t addr, int size, MemoryCells dst)
+{
+    SplitSide *s = (SplitSide*) m;
+    s->own->ops->read(s->own, addr, size, dst);
+}
+
+/*!
+  Записать ячейки через кеш своей стороны, "раскрыв" их в кеше другой стороны
+ */
+static void
+split_side_write(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    SplitSide *s = (SplitSide*) m;
+    s->own->ops->write(s->own, addr, size, src);
+    s->other->ops->reveal(s->other, addr, size, src);
+}
+
+static void
+split_side_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    SplitSide *s = (SplitSide*) m;
+    s->own->ops->reveal(s->own, addr, size, src);
+    s->other->ops->reveal(s->other, addr, size, src);
+}
+
+/*!
+  Прочитать ячейки через кеш своей стороны, "раскрыв" их в кеше другой стороны
+ */
+static void
+split_side_read_reveal(AbstractMemory *m, memaddr_t addr, int size, MemoryCells src)
+{
+    SplitSide *s = (SplitSide*) m;
+    s->own->ops->read_reveal(s->own, addr, size, src);
+    s->other->ops->reveal(s->other, addr, size, src);
+}
+
+/*!
+  Выполнить пачку шагов чтения: обращения к двум кешам чередуются, поэтому шаги выполняются по одному
+ */
+static void
+split_side_read_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    for (int i = 0; i < count; i++) {
+        split_side_read_reveal(m, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+}
+
+/*!
+  Выполнить пачку шагов записи (см. split_side_read_batch)
+ */
+static void
+split_side_write_batch(AbstractMemory *m, const TraceStep *steps, int count)
+{
+    for (int i = 0; i < count; i++) {
+        split_side_write(m, steps[i].addr, steps[i].size, trace_step_cells(&steps[i]));
+    }
+}
+
+/*!
+  Фиксировать состояние памяти: сбрасываются оба кеша (каждый фиксирует и общую память)
+ */
+static void
+split_side_flush(AbstractMemory *m)
+{
+    SplitCache *c = ((SplitSide*) m)->owner;
+    c->icache->ops->flush(c->icache);
+    c->dcache->ops->flush(c->dcache);
+}
+
+static void
+split_side_print_dump(AbstractMemory *m, FILE *f_out)
+{
+    SplitCache *c = ((SplitSide*) m)->owner;
+    c->mem->ops->print_dump(c->mem, f_out);
+}
+
+static AbstractMemoryOps split_data_ops =
+{
+    split_cache_free,
+    split_side_read,
+    split_side_write,
+    split_side_reveal,
+    split_side_read_reveal,
+    split_side_read_batch,
+    split_side_write_batch,
+    split_side_flush,
+    split_side_print_dump
+};
+
+static AbstractMemoryOps split_instr_ops =
+{
+    split_side_free,
+    split_side_read,
+    split_side_write,
+    split_side_reveal,
+    split_side_read_reveal,
+    split_side_read_batch,
+    split_side_write_batch,
+    split_side_flush,
+    split_side_print_dump
+};
+
+AbstractMemory *
+split_cache_create(
+    ConfigFile *cfg,
+    StatisticsInfo *icache_info,
+    StatisticsInfo *dcache_info,
+    AbstractMemory *mem,
+    Random *rnd,
+    int tag_only)
+{
+    SplitCache *c = calloc(1, sizeof(*c));
+    c->mem = mem;
+    // при ошибке cache_create освобождает только порт, общая память освобождается вместе с c:
+    c->icache = cache_create(cfg, "icache_", icache_info, split_port_create(mem), rnd, tag_only);
+    if (!c->icache) {
+        goto split_cache_create_failed;
+    }
+    c->dcache = cache_create(cfg, "dcache_", dcache_info, split_port_create(mem), rnd, tag_only);
+    if (!c->dcache) {
+        goto split_cache_create_failed;
+    }
+    c->data = (SplitSide) { { &split_data_ops, dcache_info }, c, c->dcache, c->icache };
+    c->instr = (SplitSide) { { &split_instr_ops, icache_info }, c, c->icache, c->dcache };
+    return (AbstractMemory*) c;
+split_cache_create_failed:
+    return split_cache_free((AbstractMemory*) c);
+}
+
+AbstractMemory *
+split_cache_instruction_side(AbstractMemory *m)
+{
+    return (AbstractMemory*) &((SplitCache*) m)->instr;
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,54 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file split_cache.h
+  \brief Раздельные кеши команд и данных первого уровня
+ */
+
+#ifndef SPLIT_CACHE_H_INCLUDED
+#define SPLIT_CACHE_H_INCLUDED
+
+#include "abstract_memory.h"
+#include "parse_config.h"
+#include "random.h"
+
+/*!
+  Создать раздельные кеши команд и данных поверх общей нижележащей памяти. Кеш команд
+  читает параметры с префиксом "icache_", кеш данных - с префиксом "dcache_".
+  Возвращаемая модель направляет обращения в кеш данных, модель стороны команд возвращает
+  функция split_cache_instruction_side. Запись через одну сторону без учета времени "раскрывается"
+  в другой, поэтому копии блока в обоих кешах остаются согласованными.
+  Освобождение, фиксация и печать содержимого выполняются через возвращаемую модель
+  и затрагивают оба кеша и нижележащую память.
+  \param cfg Указатель на структуру, хранящую конфигурационные параметры
+  \param icache_info Указатель на структуру, хранящую статистику кеша команд
+  \param dcache_info Указатель на структуру, хранящую статистику кеша данных
+  \param mem Указатель на дескриптор нижележащей памяти (в виде указателя на базовую структуру)
+  \param rnd Указатель на дескриптор генератора случайных чисел
+  \param tag_only Ненулевое значение, если содержимое памяти не нужно: блоки кеша не хранят данные,
+  моделируются только теги и время доступа
+  \return Указатель на модель стороны данных (в виде указателя на базовую структуру),
+  NULL в случае ошибки (mem в этом случае освобождается)
+ */
+AbstractMemory *split_cache_create(
+    ConfigFile *cfg,
+    StatisticsInfo *icache_info,
+    StatisticsInfo *dcache_info,
+    AbstractMemory *mem,
+    Random *rnd,
+    int tag_only);
+
+/*!
+  Получить модель стороны команд раздельных кешей. Она принадлежит модели m и не освобождается отдельно.
+  \param m Указатель на модель, созданную split_cache_create
+  \return Указатель на модель стороны команд (в виде указателя на базовую структуру)
+ */
+AbstractMemory *split_cache_instruction_side(AbstractMemory *m);
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
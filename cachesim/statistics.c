@@ -3,17 +3,44 @@
 #include "statistics.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 void
-statistics_add_counter(StatisticsInfo *info, int clock_counter)
+statistics_add_counter(StatisticsInfo *info, long long clock_counter)
 {
-    info->clock_counter += clock_counter;
+    for (; info; info = info->parent) {
+        info->clock_counter += clock_counter;
+    }
 }
 
 void
-statistics_add_hit_counter(StatisticsInfo *info)
+statistics_add_cache_read(StatisticsInfo *info, long long clock_counter)
+{
+    info->cache_read_counter++;
+    info->read_clock_counter += clock_counter;
+    statistics_add_counter(info, clock_counter);
+}
+
+void
+statistics_add_cache_write(StatisticsInfo *info, long long clock_counter)
+{
+    info->cache_write_counter++;
+    info->write_clock_counter += clock_counter;
+    statistics_add_counter(info, clock_counter);
+}
+
+void
+statistics_add_hit_counter(StatisticsInfo *info, long long clock_counter)
 {
     info->hit_counter++;
+    info->hit_clock_counter += clock_counter;
+}
+
+void
+statistics_add_write_hit_counter(StatisticsInfo *info, long long clock_counter)
+{
+    info->write_hit_counter++;
+    info->hit_clock_counter += clock_counter;
 }
 
 void
@@ -28,12 +55,87 @@ statistics_add_write(StatisticsInfo *info)
     info->write_counter++;
 }
 
+void
+statistics_add_cache_reads(StatisticsInfo *info, int count, long long clock_counter)
+{
+    info->cache_read_counter += count;
+    info->read_clock_counter += clock_counter;
+    statistics_add_counter(info, clock_counter);
+}
+
+void
+statistics_add_cache_writes(StatisticsInfo *info, int count, long long clock_counter)
+{
+    info->cache_write_counter += count;
+    info->write_clock_counter += clock_counter;
+    statistics_add_counter(info, clock_counter);
+}
+
+void
+statistics_add_reads(StatisticsInfo *info, int count)
+{
+    info->read_counter += count;
+}
+
+void
+statistics_add_writes(StatisticsInfo *info, int count)
+{
+    info->write_counter += count;
+}
+
+void
+statistics_add_hit_counters(StatisticsInfo *info, int count, long long clock_counter)
+{
+    info->hit_counter += count;
+    info->hit_clock_counter += clock_counter;
+}
+
+void
+statistics_add_write_hit_counters(StatisticsInfo *info, int count, long long clock_counter)
+{
+    info->write_hit_counter += count;
+    info->hit_clock_counter += clock_counter;
+}
+
 void
 statistics_add_write_back_counter(StatisticsInfo *info)
 {
     info->write_back_counter++;
 }
 
+void
+statistics_add_eviction_counter(StatisticsInfo *info)
+{
+    info->eviction_counter++;
+}
+
+long long
+statistics_clock(const StatisticsInfo *info)
+{
+    while (info->parent) {
+        info = info->parent;
+    }
+    return info->clock_counter;
+}
+
+void
+statistics_add_fill_clock(StatisticsInfo *info, long long clock_counter)
+{
+    info->fill_clock_counter += clock_counter;
+}
+
+void
+statistics_add_write_back_clock(StatisticsInfo *info, long long clock_counter)
+{
+    info->write_back_clock_counter += clock_counter;
+}
+
+void
+statistics_add_write_through_clock(StatisticsInfo *info, long long clock_counter)
+{
+    info->write_through_clock_counter += clock_counter;
+}
+
 StatisticsInfo *
 statistics_create(ConfigFile *cfg)
 {
@@ -41,11 +143,104 @@ statistics_create(ConfigFile *cfg)
     return st;
 }
 
+StatisticsInfo *
+statistics_create_child(StatisticsInfo *parent, const char *name)
+{
+    StatisticsInfo *st = calloc(1, sizeof(*st));
+    st->hit_counter_needed = 1;
+    st->name = strdup(name);
+    st->parent = parent;
+    StatisticsInfo **p = &parent->children;
+    while (*p) {
+        p = &(*p)->next;
+    }
+    *p = st;
+    return st;
+}
+
+StatisticsInfo *
+statistics_create_component(StatisticsInfo *parent, const char *name)
+{
+    StatisticsInfo *st = statistics_create_child(parent, name);
+    st->hit_counter_needed = 0;
+    st->merged = 1;
+    return st;
+}
+
+/*!
+  Подсчитать попадания дескриптора вместе с компонентами, печатаемыми в его составе
+  \param info Указатель на дескриптор статистической информации
+  \param first_level Ненулевое значение, если учитывать и уровни иерархии первого уровня
+  \param p_needed Сюда записывается, требуется ли печатать число попаданий
+  \return Суммарное число попаданий
+ */
+static long long
+statistics_merged_hits(const StatisticsInfo *info, int first_level, int *p_needed)
+{
+    long long hits = info->hit_counter;
+    *p_needed = info->hit_counter_needed;
+    for (const StatisticsInfo *c = info->children; c; c = c->next) {
+        if (c->merged || (first_level && c->first_level)) {
+            hits += c->hit_counter;
+            *p_needed |= c->hit_counter_needed;
+        }
+    }
+    return hits;
+}
+
+/*!
+  Подсчитать записи блоков в память дескриптора вместе с компонентами, печатаемыми в его составе
+  \param info Указатель на дескриптор статистической информации
+  \param first_level Ненулевое значение, если учитывать и уровни иерархии первого уровня
+  \param p_needed Сюда записывается, требуется ли печатать число записей блоков
+  \return Суммарное число записей блоков
+ */
+static long long
+statistics_merged_write_backs(const StatisticsInfo *info, int first_level, int *p_needed)
+{
+    long long write_backs = info->write_back_counter;
+    *p_needed = info->write_back_needed;
+    for (const StatisticsInfo *c = info->children; c; c = c->next) {
+        if (c->merged || (first_level && c->first_level)) {
+            write_backs += c->write_back_counter;
+            *p_needed |= c->write_back_needed;
+        }
+    }
+    return write_backs;
+}
+
+/*!
+  Распечатать счетчики корневого дескриптора (с учетом компонентов, печатаемых в его составе)
+  \param info Указатель на корневой дескриптор
+  \param out_f Файл вывода информации
+ */
+static void
+statistics_print_root(StatisticsInfo *info, FILE *out_f)
+{
+    int needed;
+    long long value;
+    fprintf(out_f, "clock count: %lld\n", info->clock_counter);
+    fprintf(out_f, "reads: %lld\n", info->read_counter);
+    fprintf(out_f, "writes: %lld\n", info->write_counter);
+    value = statistics_merged_hits(info, 0, &needed);
+    if (needed) {
+        fprintf(out_f, "read hits: %lld\n", value);
+    }
+    value = statistics_merged_write_backs(info, 0, &needed);
+    if (needed) {
+        fprintf(out_f, "cache block writes: %lld\n", value);
+    }
+}
+
 StatisticsInfo *
 statistics_free(StatisticsInfo *info)
 {
-    if (info) {
+    while (info) {
+        StatisticsInfo *next = info->next;
+        statistics_free(info->children);
+        free(info->name);
         free(info);
+        info = next;
     }
     return NULL;
 }
@@ -56,15 +251,100 @@ statistics_print(StatisticsInfo *info, FILE *out_f)
     if (!info || !out_f) {
         return;
     }
-    fprintf(out_f, "clock count: %d\n", info->clock_counter);
-    fprintf(out_f, "reads: %d\n", info->read_counter);
-    fprintf(out_f, "writes: %d\n", info->write_counter);
-    if (info->hit_counter_needed) {
-        fprintf(out_f, "read hits: %d\n", info->hit_counter);
+    statistics_print_root(info, out_f);
+    for (StatisticsInfo *c = info->children; c; c = c->next) {
+        if (c->merged) {
+            continue;
+        }
+        fprintf(out_f, "%s clock count: %lld\n", c->name, c->clock_counter);
+        fprintf(out_f, "%s reads: %lld\n", c->name, c->cache_read_counter);
+        fprintf(out_f, "%s writes: %lld\n", c->name, c->cache_write_counter);
+        fprintf(out_f, "%s read hits: %lld\n", c->name, c->hit_counter);
+        if (c->write_back_needed) {
+            fprintf(out_f, "%s cache block writes: %lld\n", c->name, c->write_back_counter);
+        }
+    }
+}
+
+void
+statistics_print_tree(StatisticsInfo *info, FILE *out_f)
+{
+    if (!info || !out_f) {
+        return;
+    }
+    statistics_print_root(info, out_f);
+    for (StatisticsInfo *c = info->children; c; c = c->next) {
+        fprintf(out_f, "%s clock count: %lld\n", c->name, c->clock_counter);
+        fprintf(out_f, "%s read clock count: %lld\n", c->name, c->read_clock_counter);
+        fprintf(out_f, "%s write clock count: %lld\n", c->name, c->write_clock_counter);
+        // попадания, промахи и такты нижележащих уровней бывают только у кешей:
+        if (c->hit_counter_needed) {
+            fprintf(out_f, "%s hit clock count: %lld\n", c->name, c->hit_clock_counter);
+            fprintf(out_f, "%s miss clock count: %lld\n", c->name, c->clock_counter - c->hit_clock_counter);
+            fprintf(out_f, "%s fill clock count: %lld\n", c->name, c->fill_clock_counter);
+            if (c->write_back_needed) {
+                fprintf(out_f, "%s write back clock count: %lld\n", c->name, c->write_back_clock_counter);
+            } else {
+                fprintf(out_f, "%s write through clock count: %lld\n", c->name, c->write_through_clock_counter);
+            }
+        }
+        fprintf(out_f, "%s reads: %lld\n", c->name, c->cache_read_counter);
+        fprintf(out_f, "%s writes: %lld\n", c->name, c->cache_write_counter);
+        if (c->hit_counter_needed) {
+            fprintf(out_f, "%s read hits: %lld\n", c->name, c->hit_counter);
+            fprintf(out_f, "%s read misses: %lld\n", c->name, c->cache_read_counter - c->hit_counter);
+            fprintf(out_f, "%s write hits: %lld\n", c->name, c->write_hit_counter);
+            fprintf(out_f, "%s write misses: %lld\n", c->name, c->cache_write_counter - c->write_hit_counter);
+            fprintf(out_f, "%s evictions: %lld\n", c->name, c->eviction_counter);
+        }
+        if (c->write_back_needed) {
+            fprintf(out_f, "%s cache block writes: %lld\n", c->name, c->write_back_counter);
+        }
+    }
+}
+
+void
+statistics_print_row_header(FILE *out_f)
+{
+    fprintf(out_f, "config\tclock count\treads\twrites\tread hits\tcache block writes\tlevels\n");
+}
+
+void
+statistics_print_row(StatisticsInfo *info, const char *name, FILE *out_f)
+{
+    int needed;
+    long long value;
+    fprintf(out_f, "%s\t%lld\t%lld\t%lld", name, info->clock_counter, info->read_counter, info->write_counter);
+    value = statistics_merged_hits(info, 1, &needed);
+    if (needed) {
+        fprintf(out_f, "\t%lld", value);
+    } else {
+        fprintf(out_f, "\t-");
+    }
+    value = statistics_merged_write_backs(info, 1, &needed);
+    if (needed) {
+        fprintf(out_f, "\t%lld", value);
+    } else {
+        fprintf(out_f, "\t-");
+    }
+    // уровни иерархии: "имя:попадания/записи блоков" через пробел
+    const char *sep = "\t";
+    for (StatisticsInfo *c = info->children; c; c = c->next) {
+        if (c->merged) {
+            continue;
+        }
+        fprintf(out_f, "%s%s:%lld/", sep, c->name, c->hit_counter);
+        if (c->write_back_needed) {
+            fprintf(out_f, "%lld", c->write_back_counter);
+        } else {
+            fprintf(out_f, "-");
+        }
+        sep = " ";
     }
-    if (info->write_back_needed) {
-        fprintf(out_f, "cache block writes: %d\n", info->write_back_counter);
+    if (*sep == '\t') {
+        fprintf(out_f, "\t-");
     }
+    fprintf(out_f, "\n");
 }
 
 /*
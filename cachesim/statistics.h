@@ -24,11 +24,27 @@ struct StatisticsInfo
 {
     int hit_counter_needed; //!< Требуется ли подсчитывать число попаданий
     int write_back_needed; //!< Требуется ли подсчитывать записи блоков кеша в память (при отложенной записи)
-    int clock_counter; //!< Общее число тактов требуемых для выполнения трассы
-    int read_counter; //!< Число операций чтения в трассе
-    int write_counter; //!< Число операций записи в трассе
-    int hit_counter; //!< Число попаданий в кеш при чтении
-    int write_back_counter; //!< Число записей блоков кеша в память при отложенной записи
+    int merged; //!< Счетчики компонента печатаются statistics_print в составе родительского дескриптора
+    int first_level; //!< Уровень иерархии получает обращения непосредственно из трассы (L1)
+    long long clock_counter; //!< Общее число тактов требуемых для выполнения трассы
+    long long read_counter; //!< Число операций чтения в трассе
+    long long write_counter; //!< Число операций записи в трассе
+    long long hit_counter; //!< Число попаданий в кеш при чтении
+    long long write_back_counter; //!< Число записей блоков кеша в память при отложенной записи
+    long long cache_read_counter; //!< Число чтений из кеша (печатается только для уровней иерархии)
+    long long cache_write_counter; //!< Число записей в кеш (печатается только для уровней иерархии)
+    long long eviction_counter; //!< Число вытеснений занятых блоков кеша
+    long long read_clock_counter; //!< Собственные такты компонента, затраченные на чтения
+    long long write_clock_counter; //!< Собственные такты компонента, затраченные на записи
+    long long write_hit_counter; //!< Число попаданий в кеш при записи
+    long long hit_clock_counter; //!< Собственные такты кеша на обращения, попавшие в кеш
+    long long fill_clock_counter; //!< Такты нижележащих уровней на загрузку блоков при промахах
+    long long write_back_clock_counter; //!< Такты нижележащих уровней на запись измененных блоков
+    long long write_through_clock_counter; //!< Такты нижележащих уровней на сквозную запись
+    char *name; //!< Имя уровня иерархии кешей, NULL для корневого дескриптора
+    StatisticsInfo *parent; //!< Дескриптор, которому передаются такты этого уровня, NULL для корневого
+    StatisticsInfo *children; //!< Первый дочерний дескриптор (уровень иерархии)
+    StatisticsInfo *next; //!< Следующий дочерний дескриптор того же родителя
 };
 
 /*!
@@ -38,7 +54,24 @@ struct StatisticsInfo
  */
 StatisticsInfo *statistics_create(ConfigFile *cfg);
 /*!
-  Освободить ресурсы
+  Создание дескриптора статистики одного уровня иерархии кешей. Такты, учтенные в нем,
+  учитываются и в родительском дескрипторе; остальные счетчики у каждого дескриптора свои.
+  Дочерние дескрипторы печатаются после родительского в порядке создания.
+  \param parent Указатель на родительский дескриптор
+  \param name Имя уровня, которым предваряются строки статистики уровня
+  \return Указатель на новый дескриптор статистической информации
+ */
+StatisticsInfo *statistics_create_child(StatisticsInfo *parent, const char *name);
+/*!
+  Создание дескриптора статистики компонента (ОЗУ или единственного кеша), счетчики которого
+  statistics_print печатает в составе родительского дескриптора, а statistics_print_tree - отдельно.
+  \param parent Указатель на родительский дескриптор
+  \param name Имя компонента
+  \return Указатель на новый дескриптор статистической информации
+ */
+StatisticsInfo *statistics_create_component(StatisticsInfo *parent, const char *name);
+/*!
+  Освободить ресурсы (вместе с дочерними дескрипторами)
   \param info Указатель на дескриптор статистической информации
   \return NULL
  */
@@ -48,7 +81,21 @@ StatisticsInfo *statistics_free(StatisticsInfo *info);
   \param info Указатель на дескриптор статистической информации
   \param clock_counter Добавляемое количество тактов
  */
-void statistics_add_counter(StatisticsInfo *info, int clock_counter);
+void statistics_add_counter(StatisticsInfo *info, long long clock_counter);
+/*!
+  Учесть чтение из кеша: добавить число к счетчику тактов (и тактов чтения)
+  и увеличить счетчик чтений из кеша на 1
+  \param info Указатель на дескриптор статистической информации
+  \param clock_counter Добавляемое количество тактов
+ */
+void statistics_add_cache_read(StatisticsInfo *info, long long clock_counter);
+/*!
+  Учесть запись в кеш: добавить число к счетчику тактов (и тактов записи)
+  и увеличить счетчик записей в кеш на 1
+  \param info Указатель на дескриптор статистической информации
+  \param clock_counter Добавляемое количество тактов
+ */
+void statistics_add_cache_write(StatisticsInfo *info, long long clock_counter);
 /*!
   Увеличить счетчик чтений на 1
   \param info Указатель на дескриптор статистической информации
@@ -60,21 +107,126 @@ void statistics_add_read(StatisticsInfo *info);
  */
 void statistics_add_write(StatisticsInfo *info);
 /*!
-  Увеличить счетчик попаданий на 1
+  Увеличить счетчик попаданий при чтении на 1
+  \param info Указатель на дескриптор статистической информации
+  \param clock_counter Собственные такты кеша, затраченные на это чтение
+ */
+void statistics_add_hit_counter(StatisticsInfo *info, long long clock_counter);
+/*!
+  Увеличить счетчик попаданий при записи на 1
+  \param info Указатель на дескриптор статистической информации
+  \param clock_counter Собственные такты кеша, затраченные на эту запись
+ */
+void statistics_add_write_hit_counter(StatisticsInfo *info, long long clock_counter);
+/*!
+  Учесть пачку чтений из кеша: добавить число к счетчику тактов (и тактов чтения)
+  и count к счетчику чтений из кеша
+  \param info Указатель на дескриптор статистической информации
+  \param count Число чтений
+  \param clock_counter Добавляемое количество тактов (суммарно за все чтения)
+ */
+void statistics_add_cache_reads(StatisticsInfo *info, int count, long long clock_counter);
+/*!
+  Учесть пачку записей в кеш: добавить число к счетчику тактов (и тактов записи)
+  и count к счетчику записей в кеш
+  \param info Указатель на дескриптор статистической информации
+  \param count Число записей
+  \param clock_counter Добавляемое количество тактов (суммарно за все записи)
+ */
+void statistics_add_cache_writes(StatisticsInfo *info, int count, long long clock_counter);
+/*!
+  Увеличить счетчик чтений на count
+  \param info Указатель на дескриптор статистической информации
+  \param count Число чтений
+ */
+void statistics_add_reads(StatisticsInfo *info, int count);
+/*!
+  Увеличить счетчик записей на count
+  \param info Указатель на дескриптор статистической информации
+  \param count Число записей
+ */
+void statistics_add_writes(StatisticsInfo *info, int count);
+/*!
+  Увеличить счетчик попаданий при чтении на count
+  \param info Указатель на дескриптор статистической информации
+  \param count Число попаданий
+  \param clock_counter Собственные такты кеша, затраченные на эти чтения
+ */
+void statistics_add_hit_counters(StatisticsInfo *info, int count, long long clock_counter);
+/*!
+  Увеличить счетчик попаданий при записи на count
   \param info Указатель на дескриптор статистической информации
+  \param count Число попаданий
+  \param clock_counter Собственные такты кеша, затраченные на эти записи
  */
-void statistics_add_hit_counter(StatisticsInfo *info);
+void statistics_add_write_hit_counters(StatisticsInfo *info, int count, long long clock_counter);
 /*!
   Увеличить счетчик отложенных записей на 1
   \param info Указатель на дескриптор статистической информации
  */
 void statistics_add_write_back_counter(StatisticsInfo *info);
+/*!
+  Увеличить счетчик вытеснений на 1
+  \param info Указатель на дескриптор статистической информации
+ */
+void statistics_add_eviction_counter(StatisticsInfo *info);
+/*!
+  Общее число тактов (корневого дескриптора). Разность значений до и после обращения
+  к нижележащей памяти - такты, которые это обращение добавило на всех нижележащих уровнях.
+  \param info Указатель на дескриптор статистической информации
+  \return Число тактов корневого дескриптора
+ */
+long long statistics_clock(const StatisticsInfo *info);
+/*!
+  Учесть такты нижележащих уровней, затраченные на загрузку блока при промахе
+  \param info Указатель на дескриптор статистической информации кеша
+  \param clock_counter Добавляемое количество тактов
+ */
+void statistics_add_fill_clock(StatisticsInfo *info, long long clock_counter);
+/*!
+  Учесть такты нижележащих уровней, затраченные на запись измененного блока
+  \param info Указатель на дескриптор статистической информации кеша
+  \param clock_counter Добавляемое количество тактов
+ */
+void statistics_add_write_back_clock(StatisticsInfo *info, long long clock_counter);
+/*!
+  Учесть такты нижележащих уровней, затраченные на сквозную запись
+  \param info Указатель на дескриптор статистической информации кеша
+  \param clock_counter Добавляемое количество тактов
+ */
+void statistics_add_write_through_clock(StatisticsInfo *info, long long clock_counter);
 /*!
   Распечатать статистическую информацию
   \param info Указатель на дескриптор статистической информации
   \param out_f Файл вывода информации
  */
 void statistics_print(StatisticsInfo *info, FILE *out_f);
+/*!
+  Распечатать статистическую информацию вместе с подробной статистикой каждого компонента
+  (включая печатаемые statistics_print в составе родителя): обращения, попадания и промахи
+  при чтении и записи, вытеснения, записи блоков, собственные такты с разбивкой на чтения
+  и записи и на попадания и промахи, а также такты нижележащих уровней, вызванные загрузкой
+  блоков, записью измененных блоков и сквозной записью
+  \param info Указатель на дескриптор статистической информации
+  \param out_f Файл вывода информации
+ */
+void statistics_print_tree(StatisticsInfo *info, FILE *out_f);
+
+/*!
+  Распечатать заголовок таблицы, строки которой печатает statistics_print_row
+  \param out_f Файл вывода информации
+ */
+void statistics_print_row_header(FILE *out_f);
+/*!
+  Распечатать статистическую информацию одной строкой таблицы (поля разделены табуляцией,
+  не подсчитываемые поля печатаются как "-"). Для иерархии кешей в столбцах попаданий и записей
+  блоков печатаются значения первого уровня, а последний столбец перечисляет попадания и записи
+  блоков каждого уровня
+  \param info Указатель на дескриптор статистической информации
+  \param name Имя строки (первое поле)
+  \param out_f Файл вывода информации
+ */
+void statistics_print_row(StatisticsInfo *info, const char *name, FILE *out_f);
 
 #endif
 
@@ -0,0 +1,160 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "sweep.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+    BATCH_SIZE = 4096 //!< Число шагов трассы в пачке
+};
+
+struct Sweep;
+
+/*!
+  Рабочий поток: обрабатывает модели с номерами first, first + threads, ...
+  \brief Описание рабочего потока
+ */
+typedef struct SweepWorker
+{
+    pthread_t thread; //!< Идентификатор потока
+    struct Sweep *sw; //!< Общее состояние
+    int first; //!< Номер первой модели потока
+} SweepWorker;
+
+/*!
+  Общее состояние прохода по трассе
+  \brief Дескриптор прохода
+ */
+typedef struct Sweep
+{
+    Simulation **sims; //!< Модели
+    int count; //!< Число моделей
+    int threads; //!< Число рабочих потоков
+    TraceStep *steps; //!< Обрабатываемая пачка
+    int step_count; //!< Число шагов в обрабатываемой пачке, 0 - трасса закончилась
+    pthread_barrier_t start; //!< Барьер начала обработки пачки
+    pthread_barrier_t done; //!< Барьер окончания обработки пачки
+    pthread_mutex_t ready; //!< Захвачен, пока запускаются потоки и создаются барьеры
+} Sweep;
+
+/*!
+  Функция рабочего потока
+ */
+static void *
+sweep_worker(void *arg)
+{
+    SweepWorker *w = arg;
+    Sweep *sw = w->sw;
+    // барьеры создаются после запуска всех потоков, когда известно их число:
+    pthread_mutex_lock(&sw->ready);
+    pthread_mutex_unlock(&sw->ready);
+    while (1) {
+        pthread_barrier_wait(&sw->start);
+        if (!sw->step_count) {
+            break;
+        }
+        // модель проходит всю пачку целиком, пока ее состояние находится в кеше процессора:
+        for (int i = w->first; i < sw->count; i += sw->threads) {
+            simulation_run(sw->sims[i], sw->steps, sw->step_count);
+        }
+        pthread_barrier_wait(&sw->done);
+    }
+    return NULL;
+}
+
+/*!
+  Прочитать очередную пачку шагов трассы
+  \param t Указатель на дескриптор трассы
+  \param steps Буфер размером BATCH_SIZE шагов
+  \param p_count Указатель, куда записывается число прочитанных шагов
+  \return 0 в случае успеха, -1 в случае ошибки
+ */
+static int
+sweep_fill(Trace *t, TraceStep *steps, int *p_count)
+{
+    int n = 0, r = 1;
+    while (n < BATCH_SIZE && (r = trace_next(t)) > 0) {
+        steps[n++] = *trace_get(t);
+    }
+    *p_count = n;
+    return (r < 0) ? -1 : 0;
+}
+
+int
+sweep_run(Simulation **sims, int count, int threads, Trace *t)
+{
+    Sweep sw = { .sims = sims, .count = count };
+    sw.threads = (threads < count) ? threads : count;
+    if (sw.threads < 1) {
+        sw.threads = 1;
+    }
+    TraceStep *batches[2] = { malloc(BATCH_SIZE * sizeof(TraceStep)), malloc(BATCH_SIZE * sizeof(TraceStep)) };
+    int counts[2];
+    SweepWorker *workers = calloc(sw.threads, sizeof(*workers));
+    if (!batches[0] || !batches[1] || !workers) {
+        fprintf(stderr, "sweep_run: out of memory\n");
+        free(workers);
+        free(batches[0]);
+        free(batches[1]);
+        return -1;
+    }
+    pthread_mutex_init(&sw.ready, NULL);
+    pthread_mutex_lock(&sw.ready);
+    int started = 0;
+    while (started < sw.threads) {
+        workers[started].sw = &sw;
+        workers[started].first = started;
+        if (pthread_create(&workers[started].thread, NULL, sweep_worker, &workers[started])) {
+            break;
+        }
+        started++;
+    }
+    // если не все потоки удалось запустить, модели распределяются между запущенными:
+    sw.threads = started;
+    pthread_barrier_init(&sw.start, NULL, started + 1);
+    pthread_barrier_init(&sw.done, NULL, started + 1);
+    pthread_mutex_unlock(&sw.ready);
+    if (!started) {
+        fprintf(stderr, "sweep_run: cannot start worker threads\n");
+    }
+
+    int k = 0;
+    int r = started ? sweep_fill(t, batches[k], &counts[k]) : -1;
+    while (1) {
+        sw.steps = batches[k];
+        sw.step_count = (r < 0) ? 0 : counts[k];
+        pthread_barrier_wait(&sw.start);
+        if (!sw.step_count) {
+            break;
+        }
+        r = sweep_fill(t, batches[k ^ 1], &counts[k ^ 1]);
+        pthread_barrier_wait(&sw.done);
+        k ^= 1;
+    }
+
+    for (int i = 0; i < sw.threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    pthread_barrier_destroy(&sw.start);
+    pthread_barrier_destroy(&sw.done);
+    pthread_mutex_destroy(&sw.ready);
+    free(workers);
+    free(batches[0]);
+    free(batches[1]);
+    if (r < 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        simulation_finish(sims[i]);
+    }
+    return 0;
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,33 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file sweep.h
+  \brief Моделирование нескольких конфигураций за один проход по трассе
+ */
+
+#ifndef SWEEP_H_INCLUDED
+#define SWEEP_H_INCLUDED
+
+#include "simulation.h"
+#include "trace.h"
+
+/*!
+  Прочитать трассу один раз и выполнить каждый ее шаг на всех моделях. Трасса читается пачками
+  в текущем потоке, модели распределяются между рабочими потоками. Пока рабочие потоки
+  обрабатывают одну пачку, читается следующая (двойная буферизация). По завершении
+  состояние памяти всех моделей фиксируется (simulation_finish).
+  \param sims Массив указателей на модели
+  \param count Число моделей
+  \param threads Число рабочих потоков (если больше числа моделей, уменьшается до него)
+  \param t Указатель на дескриптор трассы
+  \return 0 в случае успеха, -1 в случае ошибки чтения трассы или запуска потоков
+ */
+int sweep_run(Simulation **sims, int count, int threads, Trace *t);
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -4,15 +4,20 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <limits.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 enum
 {
-    LINE_BUF_SIZE = 1024,
+    LINE_BUF_SIZE = 1024, //!< Размер фрагмента строки, разбираемого за один раз (как у буфера fgets)
     MAX_LINE_LENGTH = 1000,
-    BITS_IN_BYTE = 8
+    BITS_IN_BYTE = 8,
+    READ_BUF_SIZE = 1 * MiB, //!< Размер буфера чтения текстовой трассы
+    READ_BUF_PAD = 8 //!< Запас в конце буфера под ограничитель и пословное сканирование
 };
 
 /*!
@@ -21,26 +26,123 @@ enum
  */
 struct Trace
 {
-    FILE *f; //!< Файл, из которого ведется чтение
+    int fd; //!< Дескриптор файла, из которого ведется чтение
     FILE *log_f; //!< Файл, в который выводить ошибки
     char *path; //!< Путь к файлу
-    int lineno; //!< Номер строки в файле
+    long long lineno; //!< Номер строки в файле (номер записи для двоичной трассы)
     TraceStep step; //!< Текущий считанный шаг
+    unsigned char *map; //!< Отображенный в память файл двоичной трассы, NULL для текстовой трассы
+    size_t map_size; //!< Размер отображенного файла
+    const unsigned char *pos; //!< Следующая непрочитанная запись двоичной трассы
+    const unsigned char *end; //!< Конец записей двоичной трассы
+    char *buf; //!< Буфер чтения текстовой трассы
+    char *cur; //!< Начало непрочитанных данных в буфере
+    char *lim; //!< Конец прочитанных данных в буфере (там всегда стоит ограничитель '\n')
+    int eof; //!< Флаг того, что файл текстовой трассы прочитан до конца
+    int binary; //!< Флаг двоичной трассы, которая читается через буфер (например, из канала)
 };
 
+/*!
+  Функция проверяет версию и размер записи в заголовке двоичной трассы.
+  \param h Указатель на заголовок (TRACE_BINARY_HEADER_SIZE байт), начинающийся с сигнатуры
+  \return 1, если заголовок корректен, 0 в противном случае
+ */
+static int
+trace_binary_header_valid(const unsigned char *h)
+{
+    return get_le32(h + 8) == TRACE_BINARY_VERSION
+        && get_le32(h + 12) == TRACE_BINARY_RECORD_SIZE;
+}
+
+/*!
+  Функция проверяет, является ли открытый файл трассы двоичной трассой, и если да,
+  отображает его в память.
+  \param t Указатель на дескриптор трассы
+  \return 1, если трасса двоичная, 0, если трасса текстовая, -1 в случае ошибки
+ */
+static int
+trace_map_binary(Trace *t)
+{
+    int fd = t->fd;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+        || st.st_size < TRACE_BINARY_HEADER_SIZE
+        || lseek(fd, 0, SEEK_CUR) != 0)
+    {
+        return 0;
+    }
+    unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    if (memcmp(map, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC) - 1)) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+    t->map = map;
+    t->map_size = st.st_size;
+    if (!trace_binary_header_valid(map)
+        || (t->map_size - TRACE_BINARY_HEADER_SIZE) % TRACE_BINARY_RECORD_SIZE)
+    {
+        fprintf(t->log_f, "%s: invalid binary trace header\n", t->path);
+        return -1;
+    }
+    madvise(map, t->map_size, MADV_SEQUENTIAL);
+    t->pos = map + TRACE_BINARY_HEADER_SIZE;
+    t->end = map + t->map_size;
+    return 1;
+}
+
+static void trace_fill(Trace *t);
+
+/*!
+  Функция проверяет, начинается ли трасса, которую нельзя отобразить в память
+  (канал, терминал), с заголовка двоичной трассы, и если да, пропускает заголовок.
+  Записи такой трассы затем читаются через буфер текстовой трассы.
+  \param t Указатель на дескриптор трассы с пустым буфером чтения
+  \return 1, если трасса двоичная, 0, если трасса текстовая, -1 в случае ошибки
+ */
+static int
+trace_read_binary_header(Trace *t)
+{
+    while (!t->eof && t->lim - t->cur < TRACE_BINARY_HEADER_SIZE) {
+        trace_fill(t);
+    }
+    const unsigned char *h = (const unsigned char *) t->cur;
+    if (t->lim - t->cur < TRACE_BINARY_HEADER_SIZE
+        || memcmp(h, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC) - 1))
+    {
+        return 0;
+    }
+    if (!trace_binary_header_valid(h)) {
+        fprintf(t->log_f, "%s: invalid binary trace header\n", t->path);
+        return -1;
+    }
+    t->cur += TRACE_BINARY_HEADER_SIZE;
+    t->binary = 1;
+    return 1;
+}
+
 Trace *
 trace_open(const char *path, FILE *log_f)
 {
     Trace *t = (Trace *) calloc(1, sizeof(*t));
     if (!path) {
         t->path = strdup("<stdin>");
-        t->f = stdin;
+        t->fd = STDIN_FILENO;
     } else {
         t->path = strdup(path);
-        t->f = fopen(path, "r");
+        t->fd = open(path, O_RDONLY);
     }
     t->log_f = log_f;
-    if (!t->f) {
+    int r = (t->fd < 0) ? -1 : trace_map_binary(t);
+    if (!r) {
+        t->buf = malloc(READ_BUF_SIZE + READ_BUF_PAD);
+        memset(t->buf, '\n', READ_BUF_PAD);
+        t->cur = t->lim = t->buf;
+        r = trace_read_binary_header(t);
+    }
+    if (r < 0) {
         t = trace_close(t);
     }
     return t;
@@ -50,9 +152,13 @@ Trace *
 trace_close(Trace *t)
 {
     if (t) {
-        if (t->f && t->f != stdin) {
-            fclose(t->f);
+        if (t->map) {
+            munmap(t->map, t->map_size);
         }
+        if (t->fd >= 0 && t->fd != STDIN_FILENO) {
+            close(t->fd);
+        }
+        free(t->buf);
         free(t->path);
         free(t);
     }
@@ -62,7 +168,7 @@ trace_close(Trace *t)
 static int
 trace_error(const Trace *t, const char *text)
 {
-    fprintf(t->log_f, "%s: %d: trace_next: %s\n", t->path, t->lineno, text);
+    fprintf(t->log_f, "%s: %lld: trace_next: %s\n", t->path, t->lineno, text);
     return -1;
 }
 
@@ -72,80 +178,356 @@ is_size(char ch)
     return (ch == '1' || ch == '2' || ch == '4' || ch == '8');
 }
 
-static inline unsigned char
-get_last_byte(int value)
+/*!
+  Пробельный символ в смысле isspace для локали "C"
+ */
+static inline int
+is_space(char ch)
 {
-	return value & 0xFF;
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+static inline int
+hex_digit(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+static inline const char *
+skip_spaces(const char *p, const char *end)
+{
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+/*!
+  Функция разбирает целое число так же, как это делают преобразования %llx и %lld функции sscanf:
+  необязательный знак, для base = 16 необязательный префикс 0x, затем цифры.
+  \param p Указатель на текущую позицию в строке, сдвигается за разобранное число
+  \param end Конец строки
+  \param base Основание системы счисления (10 или 16)
+  \param p_value Сюда записывается модуль числа
+  \param p_neg Сюда записывается 1, если число отрицательное
+  \return 1 в случае успеха, 0, если число не найдено,
+  -1, если модуль числа не представим в unsigned long long (strtoul выставил бы ERANGE)
+ */
+static int
+parse_number(const char **p, const char *end, int base,
+    unsigned long long *p_value, int *p_neg)
+{
+    const char *s = *p;
+    *p_neg = 0;
+    if (s < end && (*s == '-' || *s == '+')) {
+        *p_neg = (*s++ == '-');
+    }
+    const char *digits = s;
+    if (base == 16 && s + 1 < end && *s == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        // '0' считается цифрой, даже если после префикса цифр нет
+        s += 2;
+    }
+    unsigned long long value = 0;
+    int overflow = 0, d;
+    for (; s < end && (d = hex_digit(*s)) >= 0 && d < base; s++) {
+        if (value > (ULLONG_MAX - d) / base) {
+            overflow = 1;
+        }
+        value = value * base + d;
+    }
+    *p = s;
+    if (s == digits) {
+        return 0;
+    }
+    *p_value = value;
+    return overflow ? -1 : 1;
 }
 
 /*!
   Функция распознаёт содержимое шага трассы, записанное в текстовом виде.
+  Разбор в точности повторяет поведение sscanf(trace_line, "%c%c %llx %c %lld", ...):
+  шаг из трех полей задает однобайтовую операцию, лишние символы после пятого поля игнорируются.
   \param step Указатель на структуру, описывающую шаг (туда и пишем)
-  \param trace_line Строка, описывающая шаг трассы (непустая, без пробелов и комментариев)
+  \param p Начало строки, описывающей шаг трассы (непустой, без пробелов и комментариев в конце)
+  \param end Конец строки
   \return В случае успешного чтения возвращается 1,
   в случае ошибки при чтении возвращается -1. 
  */
 static int
-trace_step_parse(TraceStep *step, char *trace_line)
-{
-    errno = 0;
-    long long value;
-    char size;
-    int data_read = sscanf(trace_line, "%c%c %x %c %lld",
-        &step->op, &step->mem, &step->addr, &size, &value);
-    if (errno) {
+trace_step_parse(TraceStep *step, const char *p, const char *end)
+{
+    unsigned long long addr, value;
+    int neg;
+    step->op = *p++;
+    if (p == end) {
         return -1;
     }
-    if (data_read == 3) {
+    step->mem = *p++;
+    p = skip_spaces(p, end);
+    if (parse_number(&p, end, 16, &addr, &neg) <= 0) {
+        return -1;
+    }
+    step->addr = neg ? -addr : addr;
+    p = skip_spaces(p, end);
+    if (p == end) {
         step->size = 1;
-        step->value[0].flags = 1;
-        return 1;
-    } else if (data_read == 5 && is_size(size)) {
-        step->size = size - '0';
-        for (int i = step->size - 1; i >= 0; i--) {
-            step->value[i].value = get_last_byte(value);
-            value >>= BITS_IN_BYTE;
-            step->value[i].flags = 1;
-        } 
+        step->known = 1;
         return 1;
-    } else {
-        return -1;
     }
-    if ((step->op != 'R' && step->op != 'W')
-        || (step->mem != 'D' && step->mem != 'I'))
+    char size = *p++;
+    p = skip_spaces(p, end);
+    if (parse_number(&p, end, 10, &value, &neg) <= 0
+        || value > (unsigned long long) LLONG_MAX + neg
+        || !is_size(size))
     {
         return -1;
     }
+    if (neg) {
+        value = -value;
+    }
+    step->size = size - '0';
+    for (int i = step->size - 1; i >= 0; i--) {
+        step->value[i] = value & 0xFF;
+        value >>= BITS_IN_BYTE;
+    }
+    step->known = (1 << step->size) - 1;
     return 1;
 }
 
-int
-trace_next(Trace *t)
+/*!
+  Функция распознаёт запись двоичной трассы.
+  \param step Указатель на структуру, описывающую шаг (туда и пишем)
+  \param rec Указатель на начало записи
+  \return В случае успешного чтения возвращается 1,
+  в случае некорректной записи возвращается -1.
+ */
+static int
+trace_record_decode(TraceStep *step, const unsigned char *rec)
+{
+    unsigned long long addr = get_le64(rec + 8);
+    int size = rec[2];
+    if (size != 1 && size != 2 && size != 4 && size != 8) {
+        return -1;
+    }
+    step->op = rec[0];
+    step->mem = rec[1];
+    step->size = size;
+    step->addr = addr;
+    for (int i = 0; i < step->size; i++) {
+        step->value[i] = rec[16 + i];
+    }
+    step->known = (1 << step->size) - 1;
+    return 1;
+}
+
+/*!
+  Функция записывает шаг трассы в двоичном виде.
+  \param rec Указатель на начало записи (TRACE_BINARY_RECORD_SIZE байт)
+  \param step Указатель на структуру, описывающую шаг
+ */
+static void
+trace_record_encode(unsigned char *rec, const TraceStep *step)
+{
+    memset(rec, 0, TRACE_BINARY_RECORD_SIZE);
+    rec[0] = step->op;
+    rec[1] = step->mem;
+    rec[2] = step->size;
+    put_le64(rec + 8, step->addr);
+    for (int i = 0; i < step->size; i++) {
+        rec[16 + i] = step->value[i];
+    }
+}
+
+/*!
+  Функция считывает очередной шаг двоичной трассы (см. trace_next)
+ */
+static int
+trace_next_binary(Trace *t)
+{
+    if (t->pos == t->end) {
+        return 0;
+    }
+    const unsigned char *rec = t->pos;
+    t->pos += TRACE_BINARY_RECORD_SIZE;
+    t->lineno++;
+    if (trace_record_decode(&t->step, rec) < 0) {
+        return trace_error(t, "invalid record");
+    }
+    return 1;
+}
+
+/*!
+  Функция считывает очередной шаг двоичной трассы, читаемой через буфер (см. trace_next)
+ */
+static int
+trace_next_binary_stream(Trace *t)
 {
-    char buf[LINE_BUF_SIZE], *p;
-    int buflen;
+    while (!t->eof && t->lim - t->cur < TRACE_BINARY_RECORD_SIZE) {
+        trace_fill(t);
+    }
+    size_t avail = t->lim - t->cur;
+    if (!avail) {
+        return 0;
+    }
+    const unsigned char *rec = (const unsigned char *) t->cur;
+    t->lineno++;
+    if (avail < TRACE_BINARY_RECORD_SIZE) {
+        t->cur = t->lim;
+        return trace_error(t, "truncated record");
+    }
+    t->cur += TRACE_BINARY_RECORD_SIZE;
+    if (trace_record_decode(&t->step, rec) < 0) {
+        return trace_error(t, "invalid record");
+    }
+    return 1;
+}
 
-    while (fgets(buf, sizeof(buf), t->f)) {
-        t->lineno++;
-        buflen = strlen(buf);
-        if (buflen > MAX_LINE_LENGTH) {
-            return trace_error(t, "line is too long");
+/*!
+  Функция переносит непрочитанный остаток трассы в начало буфера
+  и дочитывает в буфер следующую порцию файла.
+  \param t Указатель на дескриптор трассы
+ */
+static void
+trace_fill(Trace *t)
+{
+    size_t rest = t->lim - t->cur;
+    memmove(t->buf, t->cur, rest);
+    t->cur = t->buf;
+    t->lim = t->buf + rest;
+    ssize_t r;
+    do {
+        r = read(t->fd, t->lim, t->buf + READ_BUF_SIZE - t->lim);
+    } while (r < 0 && errno == EINTR);
+    if (r <= 0) {
+        // ошибка чтения, как и раньше при fgets, считается концом файла
+        t->eof = 1;
+    } else {
+        t->lim += r;
+    }
+    memset(t->lim, '\n', READ_BUF_PAD);
+}
+
+/*!
+  Функция ищет первый из символов '\n', '#', '\0', начиная с указанной позиции.
+  Поиск ведется по 8 байт за раз, поэтому в буфере за ограничителем '\n'
+  должно быть не менее 7 доступных для чтения байт.
+ */
+static inline const char *
+find_line_break(const char *p)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const unsigned long long ones = 0x0101010101010101ULL;
+    const unsigned long long highs = 0x8080808080808080ULL;
+    for (;; p += sizeof(unsigned long long)) {
+        unsigned long long w, nl, hash;
+        memcpy(&w, p, sizeof(w));
+        nl = w ^ (ones * '\n');
+        hash = w ^ (ones * '#');
+        // старший бит выставлен в байтах, равных нулю (младший из найденных - точно)
+        unsigned long long m = ((w - ones) & ~w)
+            | ((nl - ones) & ~nl)
+            | ((hash - ones) & ~hash);
+        m &= highs;
+        if (m) {
+            return p + (__builtin_ctzll(m) / BITS_IN_BYTE);
         }
-        if ((p = strchr(buf, '#'))) {
-            *p = 0;
-            buflen = strlen(buf);
+    }
+#else
+    while (*p != '\n' && *p != '#' && *p) {
+        ++p;
+    }
+    return p;
+#endif
+}
+
+/*!
+  Функция выделяет очередной фрагмент строки трассы так, как его вернула бы fgets
+  с буфером LINE_BUF_SIZE, и при необходимости дочитывает файл. Используется в редких случаях:
+  комментарии, нулевые байты, слишком длинные строки, строки на границе буфера.
+  \param t Указатель на дескриптор трассы
+  \param p_end Сюда записывается конец значимой части фрагмента (до комментария)
+  \param p_next Сюда записывается начало следующего фрагмента
+  \return 1, если фрагмент выделен (t->cur указывает на его начало),
+  0 в случае конца файла, -1 если строка слишком длинная
+ */
+static int
+trace_next_chunk(Trace *t, char **p_end, char **p_next)
+{
+    char *nl;
+    size_t avail, look;
+    for (;;) {
+        avail = t->lim - t->cur;
+        look = (avail < LINE_BUF_SIZE - 1) ? avail : LINE_BUF_SIZE - 1;
+        nl = memchr(t->cur, '\n', look);
+        if (nl || look == LINE_BUF_SIZE - 1 || t->eof) {
+            break;
         }
-        while (buflen > 0 && isspace(buf[buflen - 1])) {
-            --buflen;
+        trace_fill(t);
+    }
+    char *s = t->cur;
+    char *next = (nl) ? nl + 1 : s + look;
+    if (next == s) {
+        return 0;
+    }
+    t->lineno++;
+    // fgets не различает нулевой байт и конец строки:
+    char *z = memchr(s, '\0', next - s);
+    char *e = (z) ? z : next;
+    if (e - s > MAX_LINE_LENGTH) {
+        return trace_error(t, "line is too long");
+    }
+    char *hash = memchr(s, '#', e - s);
+    *p_end = (hash) ? hash : e;
+    *p_next = next;
+    return 1;
+}
+
+/*!
+  Функция считывает очередной шаг текстовой трассы (см. trace_next)
+ */
+static int
+trace_next_text(Trace *t)
+{
+    for (;;) {
+        char *s = t->cur, *e, *next;
+        char *p = (char *) find_line_break(s);
+        if (*p == '\n' && p < t->lim && p - s < MAX_LINE_LENGTH) {
+            // типичный случай: строка целиком в буфере, без комментария
+            t->lineno++;
+            e = p;
+            next = p + 1;
+        } else {
+            int r = trace_next_chunk(t, &e, &next);
+            if (r <= 0) {
+                return r;
+            }
+            s = t->cur;
         }
-        buf[buflen] = 0;
-        if (!buflen) {
+        t->cur = next;
+        while (e > s && is_space(e[-1])) {
+            --e;
+        }
+        if (e == s) {
             continue;
         }
         //пробелы и комментарии в конце удалены, строка непустая
-        return trace_step_parse(&t->step, buf);
+        return trace_step_parse(&t->step, s, e);
     }
-    return 0;
+}
+
+int
+trace_next(Trace *t)
+{
+    if (t->map) {
+        return trace_next_binary(t);
+    }
+    if (t->binary) {
+        return trace_next_binary_stream(t);
+    }
+    return trace_next_text(t);
 }
 
 TraceStep *
@@ -154,6 +536,34 @@ trace_get(Trace *t)
     return (t) ? &t->step : NULL;
 }
 
+int
+trace_convert(Trace *t, const char *path)
+{
+    FILE *out_f = fopen(path, "wb");
+    if (!out_f) {
+        fprintf(t->log_f, "Failed to open %s for writing\n", path);
+        return -1;
+    }
+    unsigned char rec[TRACE_BINARY_RECORD_SIZE];
+    memcpy(rec, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC) - 1);
+    put_le32(rec + 8, TRACE_BINARY_VERSION);
+    put_le32(rec + 12, TRACE_BINARY_RECORD_SIZE);
+    int ok = fwrite(rec, TRACE_BINARY_HEADER_SIZE, 1, out_f) == 1;
+    int r = 0;
+    while (ok && (r = trace_next(t)) > 0) {
+        trace_record_encode(rec, &t->step);
+        ok = fwrite(rec, sizeof(rec), 1, out_f) == 1;
+    }
+    if (fclose(out_f) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(t->log_f, "Failed to write %s\n", path);
+        return -1;
+    }
+    return (r < 0) ? -1 : 0;
+}
+
 /*
  * Local variables:
  *  c-basic-offset: 4
@@ -22,9 +22,37 @@ typedef struct TraceStep
     char mem; //!< 'D' - память данных, 'I' - память инструкций
     memaddr_t addr; //!< адрес в памяти
     int size; //!< размер операции (1, 2, 4, 8)
-    MemoryCell value[8]; //!< данные для чтения/записи
+    unsigned char value[8]; //!< данные для чтения/записи
+    unsigned char known; //!< битовая маска известности байтов value (см. MemoryCells)
 } TraceStep;
 
+/*!
+  Получить описание данных шага трассы в виде последовательности ячеек
+  \param ts Указатель на структуру описания шага трассы
+ */
+static inline MemoryCells
+trace_step_cells(const TraceStep *ts)
+{
+    return (MemoryCells) { (unsigned char *) ts->value, (unsigned char *) &ts->known, 0 };
+}
+
+/*!
+  Двоичный формат трассы. Файл начинается с заголовка длины TRACE_BINARY_HEADER_SIZE:
+  сигнатура TRACE_BINARY_MAGIC (8 байт), версия формата (4 байта) и размер записи (4 байта).
+  Далее следуют записи фиксированной длины TRACE_BINARY_RECORD_SIZE, по одной на шаг трассы:
+  op (1 байт), mem (1 байт), size (1 байт), 5 резервных байт, addr (8 байт),
+  данные value[0..7] (8 байт, используются первые size байт).
+  Все многобайтовые поля записаны в порядке little-endian.
+ */
+#define TRACE_BINARY_MAGIC "CSBTRACE"
+
+enum
+{
+    TRACE_BINARY_VERSION = 1, //!< Версия двоичного формата трассы
+    TRACE_BINARY_HEADER_SIZE = 16, //!< Размер заголовка двоичной трассы
+    TRACE_BINARY_RECORD_SIZE = 24 //!< Размер одной записи двоичной трассы
+};
+
 /*!
   Структура хранит состояние чтения трассы. Полное описание структуры
   находится в trace.c
@@ -33,7 +61,9 @@ struct Trace;
 typedef struct Trace Trace;
 
 /*!
-  Функция открывает файл трассы.
+  Функция открывает файл трассы. Формат трассы (текстовый или двоичный) определяется
+  по сигнатуре в начале файла. Двоичная трасса из обычного файла (в том числе перенаправленного
+  на stdin) отображается в память с помощью mmap, из канала - читается через буфер.
   \param path Путь к файлу, NULL означает чтение из stdin
   \param log_f Файл, в который выводить ошибки
   \return Указатель на дескриптор трассы, или NULL при ошибке
@@ -63,6 +93,14 @@ int trace_next(Trace *t);
  */
 TraceStep *trace_get(Trace *t);
 
+/*!
+  Функция переписывает все оставшиеся шаги трассы в файл в двоичном формате.
+  \param t Указатель на дескриптор исходной трассы
+  \param path Путь к создаваемому файлу двоичной трассы
+  \return 0 в случае успеха, -1 в случае ошибки чтения трассы или записи файла
+ */
+int trace_convert(Trace *t, const char *path);
+
 #endif
 
 /*
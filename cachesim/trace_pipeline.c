@@ -0,0 +1,151 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+#include "trace_pipeline.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+enum
+{
+    BATCH_SIZE = 4096, //!< Число шагов трассы в одной пачке
+    RING_SIZE = 8, //!< Число пачек в кольцевом буфере
+    SPIN_COUNT = 256, //!< Число проверок кольцевого буфера перед уступанием процессора
+    CACHE_LINE_SIZE = 64
+};
+
+/*!
+  Пачка шагов трассы
+  \brief Элемент кольцевого буфера
+ */
+typedef struct TraceBatch
+{
+    int count; //!< Число шагов в пачке
+    int status; //!< 1, если за пачкой последуют другие, иначе результат trace_next (0 или -1)
+    TraceStep steps[BATCH_SIZE]; //!< Шаги трассы
+} TraceBatch;
+
+/*!
+  Структура описывает конвейер чтения трассы. Счетчики head и tail только растут,
+  номер элемента буфера получается взятием остатка от деления на RING_SIZE.
+  \brief Дескриптор конвейера чтения трассы
+ */
+struct TracePipeline
+{
+    Trace *t; //!< Читаемая трасса
+    TraceBatch *ring; //!< Кольцевой буфер пачек
+    pthread_t reader; //!< Поток чтения трассы
+    //! Число опубликованных пачек (пишет только поток чтения)
+    unsigned long head __attribute__((aligned(CACHE_LINE_SIZE)));
+    //! Число освобожденных пачек (пишет только поток моделирования)
+    unsigned long tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    int stop; //!< Просьба к потоку чтения завершиться
+    int held; //!< Поток моделирования удерживает пачку с номером tail
+    int status; //!< Результат чтения последней пачки, если она уже получена, иначе 1
+};
+
+/*!
+  Функция ожидания, используемая обеими сторонами кольцевого буфера
+  \param spins Счетчик неудачных проверок
+ */
+static inline void
+pipeline_wait(int *spins)
+{
+    if (++*spins >= SPIN_COUNT) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+/*!
+  Тело потока чтения трассы
+  \param arg Указатель на дескриптор конвейера
+ */
+static void *
+pipeline_reader(void *arg)
+{
+    TracePipeline *p = arg;
+    unsigned long head = p->head;
+    int r = 1;
+    do {
+        int spins = 0;
+        while (head - __atomic_load_n(&p->tail, __ATOMIC_ACQUIRE) == RING_SIZE) {
+            if (__atomic_load_n(&p->stop, __ATOMIC_RELAXED)) {
+                return NULL;
+            }
+            pipeline_wait(&spins);
+        }
+        TraceBatch *b = &p->ring[head % RING_SIZE];
+        b->count = 0;
+        while (b->count < BATCH_SIZE && (r = trace_next(p->t)) > 0) {
+            b->steps[b->count++] = *trace_get(p->t);
+        }
+        b->status = (b->count == BATCH_SIZE) ? 1 : r;
+        __atomic_store_n(&p->head, ++head, __ATOMIC_RELEASE);
+    } while (r > 0 && !__atomic_load_n(&p->stop, __ATOMIC_RELAXED));
+    return NULL;
+}
+
+TracePipeline *
+trace_pipeline_start(Trace *t)
+{
+    TracePipeline *p = NULL;
+    if (posix_memalign((void **) &p, CACHE_LINE_SIZE, sizeof(*p))) {
+        return NULL;
+    }
+    p->t = t;
+    p->head = p->tail = 0;
+    p->stop = p->held = 0;
+    p->status = 1;
+    p->ring = malloc(RING_SIZE * sizeof(*p->ring));
+    if (!p->ring || pthread_create(&p->reader, NULL, pipeline_reader, p)) {
+        free(p->ring);
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+TracePipeline *
+trace_pipeline_stop(TracePipeline *p)
+{
+    if (p) {
+        __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+        // освобождаем место в буфере, чтобы поток чтения не ждал его вечно:
+        __atomic_store_n(&p->tail, p->tail + p->held, __ATOMIC_RELEASE);
+        pthread_join(p->reader, NULL);
+        free(p->ring);
+        free(p);
+    }
+    return NULL;
+}
+
+int
+trace_pipeline_next(TracePipeline *p, TraceStep **p_steps)
+{
+    if (p->held) {
+        __atomic_store_n(&p->tail, p->tail + 1, __ATOMIC_RELEASE);
+        p->held = 0;
+    }
+    if (p->status <= 0) {
+        return p->status;
+    }
+    int spins = 0;
+    while (__atomic_load_n(&p->head, __ATOMIC_ACQUIRE) == p->tail) {
+        pipeline_wait(&spins);
+    }
+    TraceBatch *b = &p->ring[p->tail % RING_SIZE];
+    p->held = 1;
+    p->status = b->status;
+    if (!b->count) {
+        return p->status;
+    }
+    *p_steps = b->steps;
+    return b->count;
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
@@ -0,0 +1,52 @@
+/* -*- mode:c; coding: utf-8 -*- */
+
+/*!
+  \file trace_pipeline.h
+  \brief Конвейерное чтение трассы в отдельном потоке
+ */
+
+#ifndef TRACE_PIPELINE_H_INCLUDED
+#define TRACE_PIPELINE_H_INCLUDED
+
+#include "trace.h"
+
+/*!
+  Структура хранит состояние конвейера чтения трассы. Полное описание структуры
+  находится в trace_pipeline.c
+ */
+struct TracePipeline;
+typedef struct TracePipeline TracePipeline;
+
+/*!
+  Функция запускает поток, который разбирает трассу и передает шаги трассы пачками
+  через кольцевой буфер без блокировок (один писатель, один читатель).
+  \param t Указатель на дескриптор трассы. До остановки конвейера трассой пользуется только поток чтения
+  \return Указатель на дескриптор конвейера, или NULL при ошибке
+ */
+TracePipeline *trace_pipeline_start(Trace *t);
+
+/*!
+  Функция останавливает поток чтения и освобождает ресурсы конвейера. Трасса не закрывается.
+  \param p Указатель на дескриптор конвейера
+  \return Указатель NULL
+ */
+TracePipeline *trace_pipeline_stop(TracePipeline *p);
+
+/*!
+  Функция получает очередную пачку шагов трассы. Пачка остается действительной
+  до следующего вызова trace_pipeline_next или trace_pipeline_stop.
+  \param p Указатель на дескриптор конвейера
+  \param p_steps Сюда записывается указатель на первый шаг пачки
+  \return Число шагов в пачке (больше 0),
+  0 в случае достижения конца трассы,
+  -1 в случае ошибки при чтении трассы (шаги до ошибки к этому моменту уже выданы).
+ */
+int trace_pipeline_next(TracePipeline *p, TraceStep **p_steps);
+
+#endif
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ * End:
+ */
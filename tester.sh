@@ -1,12 +1,199 @@
 #!/bin/bash
+# ./tester.sh <type>     - трассы tests/10000trace* на конфигурации tests/<type>.cfg
+# ./tester.sh bin <type> - то же, но трассы предварительно преобразуются в двоичный формат
+#                        (и подаются как файлом, так и через канал)
+# ./tester.sh pipeline <type> - то же в конвейерном режиме (--pipeline)
+# ./tester.sh sweep      - строки --sweep по всем конфигурациям сравниваются с отдельными запусками
+# ./tester.sh mrc        - кривые попаданий: приближенные (--sample-rate и --sample-size) и точные;
+#                        точные строки также сравниваются с --statistics кешей LRU той же геометрии
+# ./tester.sh hi <type> - трассы, сдвинутые выше 4 GiB, на ОЗУ размером 2^48: статистика та же
+# ./tester.sh image <type> - трасса моделируется двумя половинами через образ ОЗУ
+#                        (--dump-memory-binary, --initial-memory): дамп и образ те же, что за один запуск
+# ./tester.sh compact    - сжатый дамп (--dump-memory-compact) трасс, сдвинутых выше 4 GiB, на tests/lvl.cfg
+#                        с ОЗУ размером 2^48
+# ./tester.sh tree <type> - подробная статистика по компонентам (--statistics-tree)
+# ./tester.sh id <type>   - трасса tests/10000idtrace с обращениями к командам (I) и данным (D):
+#                        дамп и статистика, а также подробная статистика (--statistics-tree)
+
+# Собрать строку таблицы --sweep из вывода --statistics конфигурации $1
+statistics_row()
+{
+	awk -v name=$1 '
+		/^clock count: /        { clock = $3 }
+		/^reads: /              { reads = $2 }
+		/^writes: /             { writes = $2 }
+		/^read hits: /          { hits = $3 }
+		/^cache block writes: / { wbs = $4 }
+		/^[^ ]+ clock count: /  { n++; level[n] = $1; lwbs[n] = "-" }
+		/^[^ ]+ read hits: /    { lhits[n] = $4 }
+		/^[^ ]+ cache block writes: / { lwbs[n] = $5 }
+		END {
+			# первый уровень - L1 или пара раздельных кешей icache и dcache
+			first = (level[1] == "icache") ? 2 : 1
+			for (i = 1; n && i <= first; i++) {
+				hits += lhits[i]
+				if (lwbs[i] != "-") {
+					wbs += lwbs[i]
+				}
+			}
+			levels = n ? "" : "-"
+			for (i = 1; i <= n; i++) {
+				levels = levels (i > 1 ? " " : "") level[i] ":" lhits[i] "/" lwbs[i]
+			}
+			printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\n", name, clock, reads, writes,
+				hits == "" ? "-" : hits, wbs == "" ? "-" : wbs, levels
+		}'
+}
+
+mode=$1
+if [ $mode == 'sweep' ]; then
+	cfgs=$(ls tests/*.cfg | grep -v dc.cfg)
+	for i in {0..9}
+	do
+		echo "
+		Launch $i"
+		./cachesim/cachesim --sweep $cfgs < tests/10000trace$i | tail -n +2 > tests/results/sweep/10000$i.txt
+		for cfg in $cfgs
+		do
+			./cachesim/cachesim --statistics $cfg < tests/10000trace$i | statistics_row $cfg
+		done | diff tests/results/sweep/10000$i.txt -
+	done
+	exit
+fi
+if [ $mode == 'mrc' ]; then
+	cfg=$(mktemp)
+	for i in {0..9}
+	do
+		echo "
+		Launch $i"
+		./cachesim/cachesim --miss-ratio-curve --sample-rate 0.1 < tests/10000trace$i > tests/results/mrc/10000$i.txt
+		./cachesim/cachesim --miss-ratio-curve --sample-size 64 < tests/10000trace$i >> tests/results/mrc/10000$i.txt
+		./cachesim/cachesim --miss-ratio-curve < tests/10000trace$i >> tests/results/mrc/10000$i.txt
+		diff tests/results/mrc/10000$i.txt tests/answers/mrc/10000$i.txt
+		# точные строки сравниваются с моделированием кешей LRU с отложенной записью той же геометрии
+		for bs in 16 32
+		do
+			for assoc in direct 2 4 full
+			do
+				for size in 1024 2048
+				do
+					sed -e "s/^cache_size = .*/cache_size = $size/" -e "s/^block_size = .*/block_size = $bs/" \
+						-e "s/^associativity = .*/associativity = $assoc/" \
+						-e 's/^replacement_strategy = .*/replacement_strategy = lru/' tests/swb.cfg > $cfg
+					./cachesim/cachesim --statistics $cfg < tests/10000trace$i \
+						| awk -v row="$bs\t$assoc\t$size" '/^read hits: / { print row "\t" $3 }'
+				done
+			done
+		done | diff - <(./cachesim/cachesim --miss-ratio-curve < tests/10000trace$i | awk -F '\t' '
+			($1 == 16 || $1 == 32) && ($2 == "direct" || $2 == 2 || $2 == 4 || $2 == "full") && $3 <= 2048 {
+				print $1 "\t" $2 "\t" $3 "\t" $4
+			}')
+	done
+	rm -f $cfg
+	exit
+fi
+if [ $mode == 'hi' ]; then
+	type=$2
+	args="--statistics"
+	if [ $type == 'dc' ]; then
+		args="$args --disable-cache"
+	fi
+	cfg=$(mktemp)
+	sed 's/^memory_size = .*/memory_size = 281474976710656/' tests/$type.cfg > $cfg
+	for i in {0..9}
+	do
+		echo "
+		Launch $i"
+		# адреса трассы - 8 шестнадцатеричных цифр, приписанное 7F00 сдвигает их на 0x7F0000000000
+		sed 's/^\(..\) /\1 7F00/' tests/10000trace$i | ./cachesim/cachesim $args $cfg \
+			| diff - <(grep -v '^[0-9A-F]\{8\} ' tests/answers/$type/10000$i.txt)
+	done
+	rm -f $cfg
+	exit
+fi
+if [ $mode == 'compact' ]; then
+	cfg=$(mktemp)
+	sed 's/^memory_size = .*/memory_size = 281474976710656/' tests/lvl.cfg > $cfg
+	for i in {0..9}
+	do
+		echo "
+		Launch $i"
+		sed 's/^\(..\) /\1 7F00/' tests/10000trace$i | ./cachesim/cachesim --dump-memory-compact --statistics $cfg \
+			> tests/results/compact/10000$i.txt
+		diff tests/results/compact/10000$i.txt tests/answers/compact/10000$i.txt
+	done
+	rm -f $cfg
+	exit
+fi
+if [ $mode == 'tree' ]; then
+	type=$2
+	for i in {0..9}
+	do
+		echo "
+		Launch $i"
+		./cachesim/cachesim --statistics-tree tests/$type.cfg < tests/10000trace$i > tests/results/tree/$type/10000$i.txt
+		diff tests/results/tree/$type/10000$i.txt tests/answers/tree/$type/10000$i.txt
+	done
+	exit
+fi
+if [ $mode == 'id' ]; then
+	type=$2
+	./cachesim/cachesim --dump-memory --statistics tests/$type.cfg < tests/10000idtrace > tests/results/id/$type.txt
+	diff tests/results/id/$type.txt tests/answers/id/$type.txt
+	./cachesim/cachesim --statistics-tree tests/$type.cfg < tests/10000idtrace > tests/results/tree/$type/10000id.txt
+	diff tests/results/tree/$type/10000id.txt tests/answers/tree/$type/10000id.txt
+	exit
+fi
+if [ $mode == 'image' ]; then
+	type=$2
+	args=""
+	if [ $type == 'dc' ]; then
+		args="--disable-cache"
+	fi
+	half=$(mktemp)
+	full=$(mktemp)
+	for i in {0..9}
+	do
+		echo "
+		Launch $i"
+		./cachesim/cachesim $args --dump-memory-binary $full tests/$type.cfg < tests/10000trace$i
+		head -n 5000 tests/10000trace$i | ./cachesim/cachesim $args --dump-memory-binary $half tests/$type.cfg
+		tail -n +5001 tests/10000trace$i | ./cachesim/cachesim $args --initial-memory $half \
+			--dump-memory-binary $half --dump-memory tests/$type.cfg \
+			| diff - <(grep '^[0-9A-F]\{8\} ' tests/answers/$type/10000$i.txt)
+		cmp $half $full
+	done
+	rm -f $half $full
+	exit
+fi
+
+type=$1
+args="--dump-memory --statistics"
+if [ $mode == 'bin' ]; then
+	type=$2
+	bin=$(mktemp)
+elif [ $mode == 'pipeline' ]; then
+	type=$2
+	args="$args --pipeline"
+fi
+if [ $type == 'dc' ]; then
+	args="$args --disable-cache"
+fi
 for i in {0..9}
 do
 	echo "
 		Launch $i"
-	if [ $1 == 'dc' ]; then
-		./cachesim/cachesim --dump-memory --statistics --disable-cache tests/$1.cfg < tests/10000trace$i > tests/results/$1/10000$i.txt
-	else
-		./cachesim/cachesim --dump-memory --statistics tests/$1.cfg < tests/10000trace$i > tests/results/$1/10000$i.txt
+	trace=tests/10000trace$i
+	if [ $mode == 'bin' ]; then
+		./cachesim/cachesim --convert-trace $bin < $trace
+		trace=$bin
+	fi
+	./cachesim/cachesim $args tests/$type.cfg < $trace > tests/results/$type/10000$i.txt
+	diff tests/results/$type/10000$i.txt tests/answers/$type/10000$i.txt
+	if [ $mode == 'bin' ]; then
+		cat $bin | ./cachesim/cachesim $args tests/$type.cfg | diff - tests/answers/$type/10000$i.txt
 	fi
-	diff tests/results/$1/10000$i.txt tests/answers/$1/10000$i.txt
 done
+if [ $mode == 'bin' ]; then
+	rm -f $bin
+fi